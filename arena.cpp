@@ -0,0 +1,65 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// arena.cpp Memory for data which is all released at once
+
+#include <vector>
+#include <cstddef>
+#include "arena.h"
+
+using std::vector;
+using std::size_t;
+
+Arena::Arena()
+    : _currBlock(0), _used(0)
+{
+}
+
+// Destructor. Frees all the memory
+Arena::~Arena()
+{
+  reset();
+  unsigned int index;
+  for (index = 0; index < _blocks.size(); index++)
+    delete[] _blocks[index];
+}
+
+// Moves to the next block, allocating it if needed
+void Arena::nextBlock()
+{
+  if (_currBlock < _blocks.size())
+    _currBlock++;
+  if (_currBlock >= _blocks.size())
+    _blocks.push_back(new char[_BlockSize]);
+  _used = 0;
+}
+
+// Releases all the memory handed out
+void Arena::reset()
+{
+  unsigned int index;
+  for (index = 0; index < _bigBlocks.size(); index++)
+    delete[] _bigBlocks[index];
+  _bigBlocks.clear();
+  _currBlock = 0;
+  _used = 0;
+}
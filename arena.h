@@ -0,0 +1,134 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// arena.h Memory for data which is all released at once
+using std::vector;
+
+/* This object hands out memory from large blocks, and never frees it
+   individually. Instead, everything is released at once by reset(), which
+   keeps the blocks to use again. This suits data that lives while one file is
+   processed, which would otherwise take many small allocations from the heap
+   for each file. Requests too big for a block get their own, which are freed
+   on reset */
+class Arena
+{
+ private:
+  enum { _BlockSize = 65536 };
+
+  vector<char*> _blocks; // Kept between resets
+  vector<char*> _bigBlocks; // Freed on reset
+  unsigned int _currBlock; // Block memory is taken from
+  size_t _used; // Amount of the current block handed out
+
+  // Moves to the next block, allocating it if needed
+  void nextBlock();
+
+  // Arenas hold the memory allocated from them, so they can't be copied
+  Arena(const Arena& other);
+  Arena& operator=(const Arena& other);
+
+ public:
+  Arena();
+
+  // Destructor. Frees all the memory
+  ~Arena();
+
+  // Returns memory of the given size, aligned to the given power of two
+  void* allocate(size_t size, size_t alignment);
+
+  // Releases all the memory handed out
+  void reset();
+};
+
+/* Allocator for standard containers, which takes memory from an arena.
+   Freeing memory does nothing; it is all released when the arena is */
+template<class T> class ArenaAllocator
+{
+ private:
+  Arena* _arena;
+
+  template<class U> friend class ArenaAllocator;
+
+ public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena* arena);
+
+  // Containers make allocators for their internal types from the one they are given
+  template<class U> ArenaAllocator(const ArenaAllocator<U>& other);
+
+  T* allocate(size_t count);
+  void deallocate(T* data, size_t count);
+
+  bool operator==(const ArenaAllocator& other) const;
+  bool operator!=(const ArenaAllocator& other) const;
+};
+
+// Returns memory of the given size, aligned to the given power of two
+inline void* Arena::allocate(size_t size, size_t alignment)
+{
+  size_t start = (_used + alignment - 1) & ~(alignment - 1);
+  if ((_currBlock >= _blocks.size()) || ((start + size) > _BlockSize)) {
+    if (size > (_BlockSize / 4)) {
+      // Would waste too much of a block
+      _bigBlocks.push_back(new char[size]);
+      return _bigBlocks.back();
+    }
+    nextBlock();
+    start = 0;
+  }
+  _used = start + size;
+  return _blocks[_currBlock] + start;
+}
+
+template<class T> inline ArenaAllocator<T>::ArenaAllocator(Arena* arena)
+    : _arena(arena)
+{
+}
+
+template<class T> template<class U>
+inline ArenaAllocator<T>::ArenaAllocator(const ArenaAllocator<U>& other)
+    : _arena(other._arena)
+{
+}
+
+template<class T> inline T* ArenaAllocator<T>::allocate(size_t count)
+{
+  return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+}
+
+template<class T> inline void ArenaAllocator<T>::deallocate(T* /* data */, size_t /* count */)
+{
+  // Released with the arena
+}
+
+template<class T>
+inline bool ArenaAllocator<T>::operator==(const ArenaAllocator& other) const
+{
+  return (_arena == other._arena);
+}
+
+template<class T>
+inline bool ArenaAllocator<T>::operator!=(const ArenaAllocator& other) const
+{
+  return (_arena != other._arena);
+}
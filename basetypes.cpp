@@ -25,8 +25,13 @@
 #include <iostream>
 #include <cctype>
 #include <vector>
+#include <utility>
 #include <algorithm>
 #include <iomanip>
+#include <unordered_set>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
 #include "basetypes.h"
 
 using std::string;
@@ -36,9 +41,119 @@ using std::isdigit;
 using std::ios_base;
 using std::left;
 using std::setw;
+using std::unordered_set;
+using std::unordered_map;
+using std::make_pair;
+using std::mutex;
+using std::lock_guard;
+
+/* Interned strings are used on every thread, so the table is split into
+   parts each with its own lock, to cut down on contention. Each text is
+   mapped to whether it is kept for good */
+class InternTable {
+public:
+  enum { _Parts = 16 };
+  typedef unordered_map<string, bool> StringMap;
+
+  StringMap _strings[_Parts];
+  size_t _unsealed[_Parts]; // Texts in each part that may be freed
+  mutex _locks[_Parts];
+  bool _sealed; // True, new text may be freed. Changed with every lock held
+
+  InternTable();
+};
+
+InternTable::InternTable()
+    : _sealed(false)
+{
+  unsigned int part;
+  for (part = 0; part < _Parts; part++)
+    _unsealed[part] = 0;
+}
+
+static InternTable& internTable()
+{
+  // Created on first use, so it exists before any static token needs it
+  static InternTable table;
+  return table;
+}
+
+// Returns the stored copy of the text, adding it if needed
+const string* InternedString::intern(const string& text)
+{
+  if (text.empty())
+    return emptyText(); // Very common, and saves a lock
+  InternTable& table = internTable();
+  unsigned int part = std::hash<string>()(text) % InternTable::_Parts;
+  lock_guard<mutex> guard(table._locks[part]);
+  // Map elements never move, so the address remains valid
+  InternTable::StringMap::iterator found = table._strings[part].find(text);
+  if (found == table._strings[part].end()) {
+    found = table._strings[part].insert(make_pair(text, !table._sealed)).first;
+    if (table._sealed)
+      table._unsealed[part]++;
+  }
+  return &(found->first);
+}
+
+// Keeps all text stored so far until the program ends
+void InternedString::seal()
+{
+  InternTable& table = internTable();
+  unsigned int part;
+  for (part = 0; part < InternTable::_Parts; part++)
+    table._locks[part].lock();
+  table._sealed = true;
+  for (part = 0; part < InternTable::_Parts; part++)
+    table._locks[part].unlock();
+}
+
+// Number of texts stored since the table was sealed
+size_t InternedString::unsealedCount()
+{
+  InternTable& table = internTable();
+  size_t result = 0;
+  unsigned int part;
+  for (part = 0; part < InternTable::_Parts; part++) {
+    lock_guard<mutex> guard(table._locks[part]);
+    result += table._unsealed[part];
+  }
+  return result;
+}
+
+/* Frees the text stored since the table was sealed, except the text of the
+   given strings. Nothing else may still refer to the freed text */
+void InternedString::collect(const vector<InternedString>& keep)
+{
+  InternTable& table = internTable();
+  unordered_set<const string*> kept;
+  vector<InternedString>::const_iterator keepIndex;
+  for (keepIndex = keep.begin(); keepIndex != keep.end(); keepIndex++)
+    kept.insert(keepIndex->_text);
+
+  unsigned int part;
+  for (part = 0; part < InternTable::_Parts; part++) {
+    lock_guard<mutex> guard(table._locks[part]);
+    InternTable::StringMap::iterator index = table._strings[part].begin();
+    while (index != table._strings[part].end())
+      if ((!index->second) && (kept.find(&(index->first)) == kept.end())) {
+        index = table._strings[part].erase(index);
+        table._unsealed[part]--;
+      }
+      else
+        index++;
+  }
+}
+
+// Returns the stored empty string
+const string* InternedString::emptyText()
+{
+  static const string empty;
+  return &empty;
+}
 
 // Constructor to set at a given position in a file
-FilePosition::FilePosition(const string& fileName, int lineNo)
+FilePosition::FilePosition(const InternedString& fileName, int lineNo)
 {
     _fileName = fileName;
     _lineNo = lineNo;
@@ -59,7 +174,7 @@ Token::Token()
 }
 
 // Constructors to construct a token
-Token::Token(string lexeme, const FilePosition& location,
+Token::Token(const string& lexeme, const FilePosition& location,
              Token::TokenType tokenclass)
         : _location(location)
 {
@@ -73,7 +188,7 @@ Token::Token(char lexeme, const FilePosition& location,
              Token::TokenType tokenclass)
         : _location(location)
 {
-    _lexeme = lexeme;
+    _lexeme = string(1, lexeme);
     _location=location;
     _type=tokenclass;
     _scope = noscope;
@@ -81,7 +196,7 @@ Token::Token(char lexeme, const FilePosition& location,
 }
 
 // Constructor used for default keyword tokens
-Token::Token(string lexeme, Token::TokenType tokenclass, Token::ModType modifier)
+Token::Token(const string& lexeme, Token::TokenType tokenclass, Token::ModType modifier)
         : _location("", 0) // Not from file data
 {
     _lexeme = lexeme;
@@ -92,7 +207,7 @@ Token::Token(string lexeme, Token::TokenType tokenclass, Token::ModType modifier
 
 ostream& operator<<(ostream& stream, const Token& data)
 {
-    stream <<"le:" << data._lexeme << "  lo:" << data._location.getFileName()
+    stream <<"le:" << data.getLexeme() << "  lo:" << data._location.getFileName()
            << "-" << data._location.getLineNo() << "  cl:" << data._type
            << "  sc:" << data._scope << "  mo:" << data._modifier;
     return stream;
@@ -101,7 +216,7 @@ ostream& operator<<(ostream& stream, const Token& data)
 // Output operator for function data. It outputs the data in tabular form
 ostream& operator<<(ostream& stream, const FunctionData& data)
 {
-  stream << std::left << setw(20) << data._name << "  ";
+  stream << std::left << setw(20) << data._name.str() << "  ";
   if (data._filescope)
     stream << "file   ";
   else
@@ -113,7 +228,7 @@ ostream& operator<<(ostream& stream, const FunctionData& data)
       stream << "refrenced in ";
     else
       stream << "called from  ";
-    stream << setw(20) << data._caller;
+    stream << setw(20) << data._caller.str();
   }
   stream << "  ";
   stream << setw(14) << data._location.getFileName() << "  ";
@@ -122,10 +237,10 @@ ostream& operator<<(ostream& stream, const FunctionData& data)
 }
 
 // Constructor for functiondata
-FunctionData::FunctionData(const Token& tokendata, const string& caller)
+FunctionData::FunctionData(const Token& tokendata, const InternedString& caller)
     : _location(tokendata.getFilePosition())
 {
-  _name = tokendata.getLexeme();
+  _name = tokendata.getInternedLexeme();
   _declaration = (tokendata.getType() == Token::functdecl);
   _filescope = (tokendata.getScope() == Token::filescope);
   if (_declaration) {
@@ -138,6 +253,15 @@ FunctionData::FunctionData(const Token& tokendata, const string& caller)
   }
 }
 
+// Constructor to recreate previously found data
+FunctionData::FunctionData(const InternedString& name, const FilePosition& location,
+                           bool declaration, const InternedString& caller,
+                           bool refrence, bool filescope)
+    : _name(name), _location(location), _declaration(declaration),
+      _caller(caller), _refrence(refrence), _filescope(filescope)
+{
+}
+
 // Comparsion operator. Used to sort final function list
 bool FunctionData::operator<(const FunctionData& other) const
 {
@@ -153,7 +277,13 @@ bool FunctionData::operator<(const FunctionData& other) const
   // Declarations sort before calls
   else if (_declaration != other._declaration)
     return _declaration;
-  else
-    // Functions finally sort by location
+  // Then by location
+  else if ((_location < other._location) || (other._location < _location))
     return (_location < other._location);
+  /* The remaining fields make the order total, so sorting gives the same
+     results no matter how the functions were grouped beforehand */
+  else if (_caller != other._caller)
+    return (_caller < other._caller);
+  else
+    return ((!_refrence) && other._refrence);
 }
@@ -27,14 +27,133 @@ using std::string;
 using std::ostream;
 using std::vector;
 
+/* A string stored once for the entire run. The same names and file names appear
+   in many tokens, so each copy just refers to the stored text. Since the text
+   is unique, two of these are equal only if they refer to the same text. The
+   text is normally never freed, so references to it remain valid until the
+   program ends. A long running program keeps seeing new text, so it can seal
+   the table and later free the text stored since then that it no longer uses.
+   Interning is thread safe */
+class InternedString {
+private:
+  const string* _text;
+
+  // Returns the stored copy of the text, adding it if needed
+  static const string* intern(const string& text);
+
+  // Returns the stored empty string
+  static const string* emptyText();
+
+public:
+  // Default is the empty string
+  InternedString();
+
+  InternedString(const string& text);
+  InternedString(const char* text);
+
+  /* Uses the default copy constructor, assignment operator,
+     and destructor */
+
+  const string& str() const;
+
+  bool empty() const;
+
+  // Hash value for hash tables. The text is unique, so this hashes its address
+  size_t hash() const;
+
+  // Equality is a pointer comparison, see above
+  bool operator==(const InternedString& other) const;
+  bool operator!=(const InternedString& other) const;
+
+  /* Ordering compares the text, so sorted results are the same regardless of
+     the order strings were interned in */
+  bool operator<(const InternedString& other) const;
+  bool operator>(const InternedString& other) const;
+
+  // Keeps all text stored so far until the program ends
+  static void seal();
+
+  // Number of texts stored since the table was sealed
+  static size_t unsealedCount();
+
+  /* Frees the text stored since the table was sealed, except the text of the
+     given strings. Nothing else may still refer to the freed text */
+  static void collect(const vector<InternedString>& keep);
+};
+
+inline InternedString::InternedString()
+    : _text(emptyText())
+{
+}
+
+inline InternedString::InternedString(const string& text)
+    : _text(intern(text))
+{
+}
+
+inline InternedString::InternedString(const char* text)
+    : _text(intern(text))
+{
+}
+
+inline const string& InternedString::str() const
+{
+    return *_text;
+}
+
+inline bool InternedString::empty() const
+{
+    return _text->empty();
+}
+
+inline size_t InternedString::hash() const
+{
+    // Low bits of the address are always the same due to alignment, so mix them out
+    size_t value = reinterpret_cast<size_t>(_text) >> 4;
+    value ^= (value >> 16);
+    value *= 0x45d9f3b;
+    return (value ^ (value >> 16));
+}
+
+inline bool InternedString::operator==(const InternedString& other) const
+{
+    return (_text == other._text);
+}
+
+inline bool InternedString::operator!=(const InternedString& other) const
+{
+    return (_text != other._text);
+}
+
+inline bool InternedString::operator<(const InternedString& other) const
+{
+    return ((_text != other._text) && (*_text < *other._text));
+}
+
+inline bool InternedString::operator>(const InternedString& other) const
+{
+    return ((_text != other._text) && (*_text > *other._text));
+}
+
+// Hash function object, to use interned strings as keys of hash tables
+struct InternedStringHash
+{
+  size_t operator()(const InternedString& value) const;
+};
+
+inline size_t InternedStringHash::operator()(const InternedString& value) const
+{
+    return value.hash();
+}
+
 // Describes where in a file a piece of data came from
 class FilePosition {
 private:
-  string _fileName;
+  InternedString _fileName;
   int _lineNo;
 public:
   // Constructor to set at a given position in a file
-  FilePosition(const string& fileName, int lineNo);
+  FilePosition(const InternedString& fileName, int lineNo);
 
   /* Uses the defalt copy constructor, assignment operator,
      equality operator, and destructor */
@@ -49,6 +168,8 @@ public:
 
   const string& getFileName() const;
 
+  const InternedString& getInternedFileName() const;
+
   int getLineNo() const;
 };
 
@@ -79,6 +200,11 @@ inline bool FilePosition::operator<(const FilePosition& other) const
 }
 
 inline const string& FilePosition::getFileName() const
+{
+    return _fileName.str();
+}
+
+inline const InternedString& FilePosition::getInternedFileName() const
 {
     return _fileName;
 }
@@ -97,13 +223,17 @@ public:
                     functcall, functtypedef, typetoken, typedeftoken, statictoken,
                     compound, control, reserved, openparen, closeparen, openbrace,
                     closebrace, ampersand, fieldaccess, semicolon, declsymbol,
-                    othersymbol, tokenEOF } TokenType;
+                    othersymbol, cachedregion, regionstart, regionend,
+                    tokenEOF } TokenType;
     typedef enum { noscope, keyword, globalscope, filescope,
                     localscope } ScopeType;
     typedef enum { nomod, funcref, onearg, twoarg, threearg } ModType;
+    /* Set of token types, a bit for each. Testing a token against a set is one
+       mask, not a compare for each type. Sets are built at compile time */
+    typedef unsigned int TypeSet;
 
 private:
-  string _lexeme; // Actual data from the file
+  InternedString _lexeme; // Actual data from the file
   FilePosition _location; // where it was found
   TokenType _type; // What it means.
   ScopeType _scope; // Scope it falls in
@@ -114,11 +244,11 @@ public:
    Token();
 
   // Constructors to construct a token
-  Token(string lexeme, const FilePosition& location, TokenType tokenclass);
+  Token(const string& lexeme, const FilePosition& location, TokenType tokenclass);
   Token(char lexeme, const FilePosition& location, TokenType tokenclass);
 
   // Constructor used for default keyword tokens
-  Token(string lexeme, TokenType tokenclass, ModType modifier);
+  Token(const string& lexeme, TokenType tokenclass, ModType modifier);
 
   /* This uses the default copy constructor, assignment operator, and
      destructor */
@@ -130,6 +260,7 @@ public:
   /* Access to individual fields. The lexeme and file data are fixed when
      the token is created, but what the token means can change */
   const string& getLexeme() const;
+  const InternedString& getInternedLexeme() const;
   const FilePosition& getFilePosition() const;
   TokenType getType() const;
   ScopeType getScope() const;
@@ -141,6 +272,12 @@ public:
   // Change the meaning of the token to match the passed token
   void setToTokenMeaning(const Token& model);
 
+  // Returns the set holding the type. Join sets with |
+  static constexpr TypeSet typeSet(TokenType tokentype);
+
+  // Returns true if the type of the token is in the set
+  bool isTypeIn(TypeSet types) const;
+
   // Equality operator. This is used for searching token lists
   bool operator==(const Token& other) const;
 
@@ -151,14 +288,17 @@ public:
 
 inline void Token::setToNoToken()
 {
-    _location = FilePosition("", 0);
-    _lexeme = "";
+    _location = FilePosition(InternedString(), 0);
+    _lexeme = InternedString();
     _type=notoken;
     _scope = noscope;
     _modifier = nomod;
 }
 
 inline const string& Token::getLexeme() const
+{ return _lexeme.str(); }
+
+inline const InternedString& Token::getInternedLexeme() const
 { return _lexeme; }
 
 inline const FilePosition& Token::getFilePosition() const
@@ -167,6 +307,14 @@ inline const FilePosition& Token::getFilePosition() const
 inline Token::TokenType Token::getType() const
 { return _type; }
 
+inline constexpr Token::TypeSet Token::typeSet(Token::TokenType tokentype)
+{ return (1U << tokentype); }
+
+static_assert(Token::tokenEOF < 32, "Token types don't fit in a TypeSet");
+
+inline bool Token::isTypeIn(Token::TypeSet types) const
+{ return ((typeSet(_type) & types) != 0); }
+
 inline Token::ScopeType Token::getScope() const
 { return _scope; }
 
@@ -220,20 +368,51 @@ inline bool Token::operator>(const Token& other) const
 class FunctionData
 {
 private:
-  string _name;
+  InternedString _name;
   FilePosition _location;
   bool _declaration; // True, statement was a function declaration
-  string _caller; // Function this function call occured in
+  InternedString _caller; // Function this function call occured in
   bool _refrence; // True, refrence of function taken instead of calling it
   bool _filescope; // True, scope is restricted to a file
 
   friend ostream& operator<<(ostream& stream, const FunctionData& data);
 
 public:
-  FunctionData(const Token &tokendata, const string& caller);
+  FunctionData(const Token &tokendata, const InternedString& caller);
+
+  // Constructor to recreate previously found data
+  FunctionData(const InternedString& name, const FilePosition& location,
+               bool declaration, const InternedString& caller, bool refrence,
+               bool filescope);
 
   bool operator<(const FunctionData& other) const;
 
   /* This object uses the default copy constructor, assignment operator,
      comparison operator, and destructor */
+
+  // Access to individual fields
+  const InternedString& getName() const;
+  const FilePosition& getFilePosition() const;
+  bool isDeclaration() const;
+  const InternedString& getCaller() const;
+  bool isRefrence() const;
+  bool isFileScope() const;
 };
+
+inline const InternedString& FunctionData::getName() const
+{ return _name; }
+
+inline const FilePosition& FunctionData::getFilePosition() const
+{ return _location; }
+
+inline bool FunctionData::isDeclaration() const
+{ return _declaration; }
+
+inline const InternedString& FunctionData::getCaller() const
+{ return _caller; }
+
+inline bool FunctionData::isRefrence() const
+{ return _refrence; }
+
+inline bool FunctionData::isFileScope() const
+{ return _filescope; }
@@ -0,0 +1,438 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// benchmark.cpp Measures the speed of each layer of the indexer
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <utility>
+#include <list>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "basetypes.h"
+#include "indexstats.h"
+#include "errors.h"
+#include "filebuffer.h"
+#include "tokenizer.h"
+#include "namespace.h"
+#include "parser.h"
+#include "arena.h"
+#include "functfinder.h"
+#include "indexpool.h"
+#include "functwriter.h"
+#include "benchmark.h"
+
+using std::string;
+using std::ofstream;
+using std::ostringstream;
+using std::endl;
+using std::fixed;
+using std::setw;
+using std::setprecision;
+using std::left;
+using std::right;
+using std::bad_alloc;
+using std::malloc;
+using std::free;
+using std::remove;
+using std::getenv;
+using std::atomic;
+using std::memory_order_relaxed;
+
+typedef std::chrono::steady_clock BenchClock;
+
+#ifdef INDEX_ALLOC_COUNT
+/* Allocations are counted by replacing the global allocator. That replaces it
+   for the whole program, so it is only done in builds made for benchmarking.
+   Counting is only turned on while a layer is timed */
+static atomic<bool> countingAllocations(false);
+static atomic<unsigned long> allocationCount(0);
+
+void* operator new(size_t size)
+{
+  if (countingAllocations.load(memory_order_relaxed))
+    allocationCount.fetch_add(1, memory_order_relaxed);
+  void* result = malloc((size > 0) ? size : 1);
+  if (result == NULL)
+    throw bad_alloc();
+  return result;
+}
+
+void operator delete(void* data) noexcept
+{
+  free(data);
+}
+
+static const bool haveAllocationCount = true;
+
+// Starts counting allocations from zero
+static void startCounting()
+{
+  allocationCount = 0;
+  countingAllocations = true;
+}
+
+// Stops counting allocations, and returns how many were counted
+static unsigned long stopCounting()
+{
+  countingAllocations = false;
+  return allocationCount;
+}
+#else
+static const bool haveAllocationCount = false;
+
+static void startCounting()
+{
+}
+
+static unsigned long stopCounting()
+{
+  return 0;
+}
+#endif
+
+// Constructor. Sets the default shape, a mix of everything
+BenchmarkShape::BenchmarkShape()
+{
+  setShape(string());
+}
+
+// Sets the shape from its name. Returns false if the name is not known
+bool BenchmarkShape::setShape(const string& name)
+{
+  // Mix of everything
+  statements = 4;
+  nestDepth = 2;
+  stringLength = 24;
+  markerInterval = 8;
+  if (name == "small") { // Many tiny functions
+    statements = 1;
+    nestDepth = 0;
+    stringLength = 0;
+    markerInterval = 0;
+  }
+  else if (name == "nested") {
+    nestDepth = 12;
+    stringLength = 0;
+    markerInterval = 0;
+  }
+  else if (name == "strings") {
+    nestDepth = 0;
+    stringLength = 200;
+    markerInterval = 0;
+  }
+  else if (name == "markers") { // Line marker before every function
+    statements = 1;
+    nestDepth = 0;
+    stringLength = 0;
+    markerInterval = 1;
+  }
+  else if ((!name.empty()) && (name != "mixed"))
+    return false;
+  return true;
+}
+
+IndexBenchmark::IndexBenchmark(const BenchmarkShape& shape)
+    : _fileSize(0), _shape(shape), _minSpeed(0.0)
+{
+}
+
+// Destructor. Removes the synthetic file
+IndexBenchmark::~IndexBenchmark()
+{
+  if (!_fileName.empty())
+    remove(_fileName.c_str());
+}
+
+/* Writes the synthetic file, about the given size in bytes. Returns false if
+   it can't be written */
+bool IndexBenchmark::generate(unsigned long size)
+{
+  // A new file in the temporary directory, so no existing file is replaced
+  const char* directory = getenv("TMPDIR");
+  string nameTemplate(((directory != NULL) && (directory[0] != '\0')) ? directory : "/tmp");
+  nameTemplate += "/benchmarkXXXXXX";
+  // Replaces the Xs in place with a name no other file has
+  int handle = mkstemp(&nameTemplate[0]);
+  if (handle < 0)
+    return false;
+  close(handle);
+  _fileName = nameTemplate;
+
+  ofstream output(_fileName.c_str());
+  ostringstream text;
+  unsigned int functIndex = 0;
+  unsigned int statement;
+  unsigned int depth;
+  unsigned int lineNo = 1;
+
+  text << "# 1 \"bench0.c\"" << endl
+       << "int report(const char* text);" << endl;
+  string literal;
+  if (_shape.stringLength > 0) {
+    // Include an escaped quote, so the close quote search has work to do
+    literal.assign(_shape.stringLength, 'x');
+    if (_shape.stringLength >= 8)
+      literal.replace(_shape.stringLength / 2, 2, "\\\"");
+  }
+  while ((unsigned long)text.tellp() < size) {
+    if ((_shape.markerInterval > 0) && (functIndex > 0) &&
+        ((functIndex % _shape.markerInterval) == 0))
+      text << "# " << lineNo << " \"bench" << (functIndex / _shape.markerInterval)
+           << ".c\"" << endl;
+    text << "static int helper" << functIndex << "(int first, int second);" << endl
+         << "int bench" << functIndex << "(int value)" << endl
+         << "{" << endl
+         << "  int result = 0;" << endl;
+    for (statement = 0; statement < _shape.statements; statement++) {
+      for (depth = 0; depth < _shape.nestDepth; depth++)
+        text << "  if (value > " << depth << ") {" << endl;
+      text << "  result = result + helper" << functIndex << "(value, "
+           << statement << ");" << endl;
+      if (!literal.empty())
+        text << "  report(\"" << literal << "\");" << endl;
+      for (depth = 0; depth < _shape.nestDepth; depth++)
+        text << "  }" << endl;
+    }
+    text << "  return result;" << endl
+         << "}" << endl
+         << "static int helper" << functIndex << "(int first, int second)" << endl
+         << "{" << endl
+         << "  return first + second;" << endl
+         << "}" << endl;
+    functIndex++;
+    lineNo += 10;
+  }
+  output << text.str();
+  _fileSize = text.str().length();
+  output.close();
+  return (bool)output;
+}
+
+// Runs each layer over the file
+IndexBenchmark::LayerResult IndexBenchmark::timeFileBuffer()
+{
+  LayerResult result = { "FileBuffer", "lines", 0, 0.0, 0 };
+  ostream noLog(NULL); // Discards warnings
+  FileBuffer buffer;
+  string line;
+  buffer.setLog(noLog);
+  BenchClock::time_point startTime = BenchClock::now();
+  buffer.open(_fileName);
+  while (!buffer.haveEOF()) {
+    buffer >> line;
+    result.items++;
+  }
+  result.seconds = std::chrono::duration<double>(BenchClock::now() - startTime).count();
+  return result;
+}
+
+IndexBenchmark::LayerResult IndexBenchmark::timeTokenizer()
+{
+  LayerResult result = { "Tokenizer", "tokens", 0, 0.0, 0 };
+  ostream noLog(NULL);
+  Tokenizer tokens;
+  vector<Token> batch;
+  tokens.setLog(noLog);
+  BenchClock::time_point startTime = BenchClock::now();
+  tokens.start(_fileName);
+  while (!tokens.haveEOF()) {
+    batch.clear();
+    result.items += tokens.nextTokens(batch, 256);
+  }
+  result.seconds = std::chrono::duration<double>(BenchClock::now() - startTime).count();
+  return result;
+}
+
+IndexBenchmark::LayerResult IndexBenchmark::timeParser()
+{
+  LayerResult result = { "Parser", "functions", 0, 0.0, 0 };
+  ostream noLog(NULL);
+  Parser parser;
+  parser.setLog(noLog);
+  BenchClock::time_point startTime = BenchClock::now();
+  parser.start(_fileName);
+  while (!parser.haveEOF()) {
+    parser.nextFunction();
+    result.items++;
+  }
+  parser.finish();
+  result.seconds = std::chrono::duration<double>(BenchClock::now() - startTime).count();
+  return result;
+}
+
+IndexBenchmark::LayerResult IndexBenchmark::timeFunctFinder()
+{
+  LayerResult result = { "FunctFinder", "functions", 0, 0.0, 0 };
+  ostream noLog(NULL);
+  FunctFinder finder;
+  finder.setLog(noLog);
+  BenchClock::time_point startTime = BenchClock::now();
+  finder.start(_fileName);
+  while (!finder.haveEOF()) {
+    finder.nextFunction();
+    result.items++;
+  }
+  finder.finish();
+  result.seconds = std::chrono::duration<double>(BenchClock::now() - startTime).count();
+  return result;
+}
+
+void IndexBenchmark::report(ostream& output, const LayerResult& result,
+                            double lowerSeconds) const
+{
+  double seconds = (result.seconds > 0.0) ? result.seconds : 1e-9;
+  output << left << setw(12) << result.name << right << fixed
+         << setw(10) << result.items << " " << left << setw(10) << result.unitName << right
+         << setprecision(4) << setw(9) << result.seconds << " s"
+         << setprecision(1) << setw(9) << ((_fileSize / 1048576.0) / seconds) << " MB/s"
+         << setw(12) << (result.items / seconds) << " " << result.unitName << "/s"
+         << "  own " << setprecision(4) << (result.seconds - lowerSeconds) << " s";
+  if (haveAllocationCount)
+    output << "  allocations " << result.allocations;
+  output << endl;
+}
+
+// Returns everything the result holds as text, for comparing results
+static string describeResult(const FileResult& result)
+{
+  ostringstream text;
+  {
+    FunctionWriter writer(text);
+    vector<FunctionData>::const_iterator index;
+    for (index = result.functions.begin(); index != result.functions.end(); index++)
+      writer.add(*index);
+  } // Writer flushes here
+  text << result.log << result.trailer;
+  return text.str();
+}
+
+/* Indexes the file in each mode, and compares the results to the single
+   threaded one. Returns false if any differ */
+bool IndexBenchmark::checkModes(ostream& output)
+{
+  enum { _PoolCopies = 4 }; // Times the pool indexes the file
+  enum { _PoolThreads = 2 };
+  FunctFinder finder;
+  FileResult result;
+  string expected;
+  unsigned int index;
+  bool matched = true;
+
+  indexFile(finder, _fileName, result, NULL);
+  expected = describeResult(result);
+
+  finder.setPipelined(true);
+  indexFile(finder, _fileName, result, NULL);
+  if (describeResult(result) != expected) {
+    output << "Pipelined results differ from single threaded results" << endl;
+    matched = false;
+  }
+
+  // Several copies, so the workers index them at the same time
+  vector<string> fileNames(_PoolCopies, _fileName);
+  IndexPool workers(fileNames);
+  bool poolMatched = true;
+  workers.start(_PoolThreads);
+  for (index = 0; index < fileNames.size(); index++) {
+    if (describeResult(workers.waitForResult(index)) != expected)
+      poolMatched = false;
+    workers.releaseResult(index);
+  }
+  if (!poolMatched) {
+    output << "Multithreaded results differ from single threaded results" << endl;
+    matched = false;
+  }
+  if (matched)
+    output << "Results of every mode match" << endl;
+  return matched;
+}
+
+/* Generates a file of about the given size in kilobytes and times each
+   layer. Returns false if the modes give different results, or the indexer
+   is slower than the minimum */
+bool IndexBenchmark::run(unsigned long sizeKB, ostream& output)
+{
+  enum { _Repeats = 3 }; // Best of this many runs is reported
+  typedef LayerResult (IndexBenchmark::*LayerTimer)();
+  static const LayerTimer timers[] = { &IndexBenchmark::timeFileBuffer,
+                                       &IndexBenchmark::timeTokenizer,
+                                       &IndexBenchmark::timeParser,
+                                       &IndexBenchmark::timeFunctFinder };
+  unsigned int layer;
+  unsigned int repeat;
+  double lowerSeconds = 0.0;
+  double speed; // Of the whole indexer, in MB/s
+  bool passed;
+
+  if (!generate(sizeKB * 1024)) {
+    output << "Could not write the benchmark file in the temporary directory" << endl;
+    return false;
+  }
+  output << "Benchmark file " << _fileName << ", " << _fileSize << " bytes" << endl;
+  if (!haveAllocationCount)
+    output << "Allocations are not counted by this build. Rebuild with INDEX_ALLOC_COUNT defined to count them"
+           << endl;
+  try {
+    for (layer = 0; layer < (sizeof(timers) / sizeof(timers[0])); layer++) {
+      LayerResult best = { "", "", 0, 0.0, 0 };
+      for (repeat = 0; repeat < _Repeats; repeat++) {
+        startCounting();
+        LayerResult result = (this->*timers[layer])();
+        result.allocations = stopCounting();
+        if ((repeat == 0) || (result.seconds < best.seconds))
+          best = result;
+      }
+      report(output, best, lowerSeconds);
+      lowerSeconds = best.seconds;
+    }
+    passed = checkModes(output);
+  }
+  catch (exception& error) {
+    stopCounting();
+    output << "Benchmark stopped early due to error: " << error.what() << endl;
+    return false;
+  }
+  // The last layer timed is the whole indexer
+  speed = (_fileSize / 1048576.0) / ((lowerSeconds > 0.0) ? lowerSeconds : 1e-9);
+  if ((_minSpeed > 0.0) && (speed < _minSpeed)) {
+    output << "FunctFinder is slower than the minimum of " << setprecision(1)
+           << _minSpeed << " MB/s" << endl;
+    passed = false;
+  }
+  return passed;
+}
@@ -0,0 +1,111 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// benchmark.h Measures the speed of each layer of the indexer
+
+/* The shape of the synthetic source used for benchmarks. Each function has the
+   given number of statements, each nested inside ifs to the given depth. */
+struct BenchmarkShape
+{
+  unsigned int statements; // Statements in each function
+  unsigned int nestDepth; // Depth of if statements around each statement
+  unsigned int stringLength; // Length of the string literal in each statement
+  unsigned int markerInterval; // Functions between line markers, zero for none
+
+  // Constructor. Sets the default shape, a mix of everything
+  BenchmarkShape();
+
+  // Sets the shape from its name. Returns false if the name is not known
+  bool setShape(const string& name);
+};
+
+/* This object generates a synthetic preprocessed C file of a given size and
+   shape, then indexes it several times. Each run drives a different layer of
+   the indexer directly: FileBuffer lines, Tokenizer tokens, Parser function
+   tokens, and FunctFinder functions. Each layer uses the ones below it, so the
+   time it adds is the difference from the layer below. Throughput is reported
+   for each layer, and the number of memory allocations when the program is
+   built with INDEX_ALLOC_COUNT defined.
+     Afterward the file is indexed single threaded, pipelined, and by a pool of
+   threads, and the results must all match, so a change that makes one mode
+   faster can't quietly change what it finds. A minimum speed can also be set
+   for the whole indexer, so slowdowns are caught as well.
+     The file is a new one in the temporary directory, removed afterward */
+class IndexBenchmark
+{
+ private:
+  // Results of timing one layer
+  struct LayerResult
+  {
+    const char* name;
+    const char* unitName; // What the layer produces
+    unsigned long items; // Number of things produced
+    double seconds;
+    unsigned long allocations;
+  };
+
+  string _fileName;
+  unsigned long _fileSize;
+  BenchmarkShape _shape;
+  double _minSpeed; // Slowest allowed speed of FunctFinder in MB/s, zero for no limit
+
+  /* Writes the synthetic file, about the given size in bytes. Returns false if
+     it can't be written */
+  bool generate(unsigned long size);
+
+  // Runs each layer over the file
+  LayerResult timeFileBuffer();
+  LayerResult timeTokenizer();
+  LayerResult timeParser();
+  LayerResult timeFunctFinder();
+
+  void report(ostream& output, const LayerResult& result,
+              double lowerSeconds) const;
+
+  /* Indexes the file in each mode, and compares the results to the single
+     threaded one. Returns false if any differ */
+  bool checkModes(ostream& output);
+
+  // Copy constructor and assignment operator. This object can't be copied
+  IndexBenchmark(const IndexBenchmark& other);
+  IndexBenchmark& operator=(const IndexBenchmark& other);
+
+ public:
+  IndexBenchmark(const BenchmarkShape& shape);
+
+  // Destructor. Removes the synthetic file
+  ~IndexBenchmark();
+
+  // Sets the slowest allowed speed of the whole indexer in MB/s, zero for no limit
+  void setMinSpeed(double minSpeed);
+
+  /* Generates a file of about the given size in kilobytes and times each
+     layer. Returns false if the modes give different results, or the indexer
+     is slower than the minimum */
+  bool run(unsigned long sizeKB, ostream& output);
+};
+
+// Sets the slowest allowed speed of the whole indexer in MB/s, zero for no limit
+inline void IndexBenchmark::setMinSpeed(double minSpeed)
+{
+  _minSpeed = minSpeed;
+}
@@ -0,0 +1,351 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// binaryindex.cpp Writes and reads the function index in a compact binary form
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "basetypes.h"
+#include "binaryindex.h"
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::ifstream;
+using std::ios_base;
+using std::sort;
+using std::memcmp;
+
+static const char IndexMagic[4] = { 'F', 'I', 'D', 'X' };
+/* Increase this whenever the layout changes, so old readers reject new
+   files instead of misreading them */
+static const unsigned int IndexVersion = 1;
+
+// Appends a number to the buffer, low byte first
+static void appendNumber(string& buffer, unsigned int value)
+{
+  buffer += (char)(value & 0xFF);
+  buffer += (char)((value >> 8) & 0xFF);
+  buffer += (char)((value >> 16) & 0xFF);
+  buffer += (char)((value >> 24) & 0xFF);
+}
+
+// Orders string numbers by the text of the strings
+class StringTextLess
+{
+ private:
+  const vector<InternedString>& _strings;
+
+ public:
+  StringTextLess(const vector<InternedString>& strings);
+  bool operator()(unsigned int first, unsigned int second) const;
+};
+
+StringTextLess::StringTextLess(const vector<InternedString>& strings)
+    : _strings(strings)
+{
+}
+
+bool StringTextLess::operator()(unsigned int first, unsigned int second) const
+{
+  return (_strings[first] < _strings[second]);
+}
+
+BinaryIndexWriter::BinaryIndexWriter()
+{
+}
+
+// Returns the number of a string, adding it if needed
+unsigned int BinaryIndexWriter::findStringId(const InternedString& text)
+{
+  StringIds::const_iterator found = _stringIds.find(text);
+  if (found != _stringIds.end())
+    return found->second;
+  unsigned int id = _strings.size();
+  _stringIds[text] = id;
+  _strings.push_back(text);
+  return id;
+}
+
+void BinaryIndexWriter::add(const FunctionData& data)
+{
+  Record record;
+  record.name = findStringId(data.getName());
+  record.caller = findStringId(data.getCaller());
+  record.file = findStringId(data.getFilePosition().getInternedFileName());
+  record.lineNo = data.getFilePosition().getLineNo();
+  record.flags = (data.isDeclaration() ? 1 : 0) | (data.isRefrence() ? 2 : 0) |
+                 (data.isFileScope() ? 4 : 0);
+  _records.push_back(record);
+}
+
+// Writes the index to the named file. Returns false if it can't be written
+bool BinaryIndexWriter::write(const string& fileName) const
+{
+  unsigned int index;
+
+  // Number the strings in sorted order
+  vector<unsigned int> order(_strings.size());
+  for (index = 0; index < order.size(); index++)
+    order[index] = index;
+  sort(order.begin(), order.end(), StringTextLess(_strings));
+  vector<unsigned int> newIds(_strings.size());
+  for (index = 0; index < order.size(); index++)
+    newIds[order[index]] = index;
+
+  string stringTable;
+  string stringText;
+  for (index = 0; index < order.size(); index++) {
+    appendNumber(stringTable, stringText.length());
+    stringText += _strings[order[index]].str();
+  }
+  appendNumber(stringTable, stringText.length());
+  stringText.append((4 - (stringText.length() % 4)) % 4, '\0');
+
+  string functions;
+  string names;
+  unsigned int nameCount = 0;
+  unsigned int nameStart = 0;
+  functions.reserve(_records.size() * 20);
+  for (index = 0; index < _records.size(); index++) {
+    const Record& record = _records[index];
+    appendNumber(functions, newIds[record.name]);
+    appendNumber(functions, newIds[record.caller]);
+    appendNumber(functions, newIds[record.file]);
+    appendNumber(functions, record.lineNo);
+    appendNumber(functions, record.flags);
+    // Functions are in output order, so all uses of a name are together
+    if (((index + 1) == _records.size()) || (_records[index + 1].name != record.name)) {
+      appendNumber(names, newIds[record.name]);
+      appendNumber(names, nameStart);
+      appendNumber(names, index + 1 - nameStart);
+      nameCount++;
+      nameStart = index + 1;
+    }
+  }
+
+  string header(IndexMagic, sizeof(IndexMagic));
+  unsigned int position = 36; // Size of the header
+  appendNumber(header, IndexVersion);
+  appendNumber(header, _strings.size());
+  appendNumber(header, _records.size());
+  appendNumber(header, nameCount);
+  appendNumber(header, position);
+  position += stringTable.length();
+  appendNumber(header, position);
+  position += stringText.length();
+  appendNumber(header, position);
+  position += functions.length();
+  appendNumber(header, position);
+
+  ofstream output(fileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+  output << header << stringTable << stringText << functions << names;
+  output.close();
+  return (bool)output;
+}
+
+BinaryIndexReader::BinaryIndexReader()
+    : _data(NULL), _size(0), _isMapped(false)
+{
+  close();
+}
+
+// Destructor. Closes the index
+BinaryIndexReader::~BinaryIndexReader()
+{
+  close();
+}
+
+void BinaryIndexReader::close()
+{
+#ifdef HAVE_MMAP
+  if (_isMapped)
+    munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+  _buffer.clear();
+  _data = NULL;
+  _size = 0;
+  _isMapped = false;
+  _stringCount = 0;
+  _functionCount = 0;
+  _nameCount = 0;
+  _stringTable = NULL;
+  _stringText = NULL;
+  _functions = NULL;
+  _names = NULL;
+  _textSize = 0;
+}
+
+// Opens the named index. Returns false if it can't be read, or is not an index
+bool BinaryIndexReader::open(const string& fileName)
+{
+  close();
+#ifdef HAVE_MMAP
+  int fileDesc = ::open(fileName.c_str(), O_RDONLY);
+  if (fileDesc >= 0) {
+    struct stat fileStats;
+    if ((fstat(fileDesc, &fileStats) == 0) && S_ISREG(fileStats.st_mode) &&
+        (fileStats.st_size > 0)) {
+      void* mapping = mmap(NULL, fileStats.st_size, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+      if (mapping != MAP_FAILED) {
+        _data = static_cast<const unsigned char*>(mapping);
+        _size = fileStats.st_size;
+        _isMapped = true;
+      }
+    }
+    ::close(fileDesc);
+  }
+#endif
+  if (!_isMapped) {
+    ifstream input(fileName.c_str(), ios_base::in | ios_base::binary);
+    if (!input.is_open())
+      return false;
+    char buffer[65536];
+    while (input) {
+      input.read(buffer, sizeof(buffer));
+      _buffer.insert(_buffer.end(), buffer, buffer + input.gcount());
+    }
+    if (!_buffer.empty())
+      _data = &_buffer[0];
+    _size = _buffer.size();
+  }
+  if (!checkContents()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+// Checks the file contents make sense. Returns false if not
+bool BinaryIndexReader::checkContents()
+{
+  if ((_size < _HeaderSize) || (memcmp(_data, IndexMagic, sizeof(IndexMagic)) != 0) ||
+      (readNumber(_data + 4) != IndexVersion))
+    return false;
+  _stringCount = readNumber(_data + 8);
+  _functionCount = readNumber(_data + 12);
+  _nameCount = readNumber(_data + 16);
+  size_t tableStart = readNumber(_data + 20);
+  size_t textStart = readNumber(_data + 24);
+  size_t functionStart = readNumber(_data + 28);
+  size_t nameStart = readNumber(_data + 32);
+  // Sections must be in order, and big enough for their contents
+  if ((tableStart < _HeaderSize) ||
+      (textStart < (tableStart + (((size_t)_stringCount + 1) * 4))) ||
+      (functionStart < textStart) ||
+      (nameStart < (functionStart + ((size_t)_functionCount * _RecordSize))) ||
+      (_size < (nameStart + ((size_t)_nameCount * _NameSize))))
+    return false;
+  _stringTable = _data + tableStart;
+  _stringText = _data + textStart;
+  _functions = _data + functionStart;
+  _names = _data + nameStart;
+  _textSize = functionStart - textStart;
+  return true;
+}
+
+// Returns the text of a string by its number
+string BinaryIndexReader::getString(unsigned int id) const
+{
+  if (id >= _stringCount)
+    return string();
+  size_t start = readNumber(_stringTable + (id * 4));
+  size_t end = readNumber(_stringTable + ((id + 1) * 4));
+  if ((start > end) || (end > _textSize))
+    return string(); // Damaged file
+  return string(reinterpret_cast<const char*>(_stringText + start), end - start);
+}
+
+/* Compares a string in the index with the given text, without copying it.
+   Returns less than, equal to, or greater than zero, like strcmp() */
+int BinaryIndexReader::compareString(unsigned int id, const string& text) const
+{
+  size_t start = 0;
+  size_t end = 0;
+  if (id < _stringCount) {
+    start = readNumber(_stringTable + (id * 4));
+    end = readNumber(_stringTable + ((id + 1) * 4));
+    if ((start > end) || (end > _textSize))
+      start = end = 0;
+  }
+  size_t length = end - start;
+  size_t shorter = (length < text.length()) ? length : text.length();
+  int result = memcmp(_stringText + start, text.data(), shorter);
+  if (result != 0)
+    return result;
+  else if (length < text.length())
+    return -1;
+  else
+    return (length > text.length()) ? 1 : 0;
+}
+
+// Returns a function by its position in output order
+FunctionData BinaryIndexReader::getFunction(unsigned int index) const
+{
+  const unsigned char* record = _functions + ((size_t)index * _RecordSize);
+  unsigned int flags = readNumber(record + 16);
+  return FunctionData(getString(readNumber(record)),
+                      FilePosition(getString(readNumber(record + 8)),
+                                   readNumber(record + 12)),
+                      ((flags & 1) != 0), getString(readNumber(record + 4)),
+                      ((flags & 2) != 0), ((flags & 4) != 0));
+}
+
+/* Finds the functions with the given name. Returns false if there are none,
+   otherwise sets the position of the first one and how many there are */
+bool BinaryIndexReader::findName(const string& name, unsigned int &first,
+                                 unsigned int &count) const
+{
+  unsigned int low = 0;
+  unsigned int high = _nameCount;
+  while (low < high) {
+    unsigned int middle = low + ((high - low) / 2);
+    const unsigned char* entry = _names + ((size_t)middle * _NameSize);
+    int result = compareString(readNumber(entry), name);
+    if (result == 0) {
+      first = readNumber(entry + 4);
+      count = readNumber(entry + 8);
+      // Don't trust a damaged file to stay within the functions
+      if ((first > _functionCount) || (count > (_functionCount - first)))
+        return false;
+      return true;
+    }
+    else if (result < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return false;
+}
@@ -0,0 +1,146 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// binaryindex.h Writes and reads the function index in a compact binary form
+using std::unordered_map;
+
+/* The binary index holds the same data as the output table, in a form that
+   can be used directly from memory without parsing it. All numbers are four
+   bytes, little endian, and every section starts on a four byte boundary:
+     header: "FIDX", format version, string count, function count, name count,
+       and the start of the string table, string text, functions, and names
+     string table: start of each string within the string text, plus one more
+       entry giving the end of the last one. Strings are sorted, so their
+       numbers sort the same way as their text
+     string text: the strings, one after the other, with no terminators
+     functions: in output order. Each has the name, caller, and file name as
+       string numbers, the line number, and flags: 1 for a declaration, 2 for a
+       refrence, and 4 for file scope
+     names: one entry per function name in name order. Each has the string
+       number of the name, the first function with the name, and the number of
+       functions with it */
+
+// Writes a binary index. Functions must be added in output order
+class BinaryIndexWriter
+{
+ private:
+  typedef unordered_map<InternedString, unsigned int, InternedStringHash> StringIds;
+
+  // Like FunctionData, but with string numbers instead of strings
+  struct Record
+  {
+    unsigned int name;
+    unsigned int caller;
+    unsigned int file;
+    unsigned int lineNo;
+    unsigned int flags;
+  };
+
+  StringIds _stringIds;
+  vector<InternedString> _strings; // In the order first found
+  vector<Record> _records;
+
+  // Returns the number of a string, adding it if needed
+  unsigned int findStringId(const InternedString& text);
+
+ public:
+  BinaryIndexWriter();
+
+  // This object uses the default copy constructor, assignment operator, and destructor
+
+  void add(const FunctionData& data);
+
+  // Writes the index to the named file. Returns false if it can't be written
+  bool write(const string& fileName) const;
+};
+
+/* Reads a binary index. The file is mapped into memory where possible, and is
+   used as is. Lookups binary search the name index */
+class BinaryIndexReader
+{
+ private:
+  enum { _HeaderSize = 36 };
+  enum { _RecordSize = 20 };
+  enum { _NameSize = 12 };
+
+  const unsigned char* _data; // Contents of the index file
+  size_t _size;
+  bool _isMapped; // True, _data is a mapping, otherwise it points into _buffer
+  vector<unsigned char> _buffer; // Used when the file can't be mapped
+  unsigned int _stringCount;
+  unsigned int _functionCount;
+  unsigned int _nameCount;
+  const unsigned char* _stringTable;
+  const unsigned char* _stringText;
+  const unsigned char* _functions;
+  const unsigned char* _names;
+  size_t _textSize; // Length of the string text
+
+  // Returns the number stored at the given location
+  static unsigned int readNumber(const unsigned char* data);
+
+  /* Compares a string in the index with the given text, without copying it.
+     Returns less than, equal to, or greater than zero, like strcmp() */
+  int compareString(unsigned int id, const string& text) const;
+
+  // Checks the file contents make sense. Returns false if not
+  bool checkContents();
+
+  // This object controls a file mapping, so it can't be copied
+  BinaryIndexReader(const BinaryIndexReader& other);
+  BinaryIndexReader& operator=(const BinaryIndexReader& other);
+
+ public:
+  BinaryIndexReader();
+
+  // Destructor. Closes the index
+  ~BinaryIndexReader();
+
+  // Opens the named index. Returns false if it can't be read, or is not an index
+  bool open(const string& fileName);
+
+  void close();
+
+  unsigned int getFunctionCount() const;
+
+  // Returns a function by its position in output order
+  FunctionData getFunction(unsigned int index) const;
+
+  // Returns the text of a string by its number
+  string getString(unsigned int id) const;
+
+  /* Finds the functions with the given name. Returns false if there are none,
+     otherwise sets the position of the first one and how many there are */
+  bool findName(const string& name, unsigned int &first, unsigned int &count) const;
+};
+
+// Returns the number stored at the given location
+inline unsigned int BinaryIndexReader::readNumber(const unsigned char* data)
+{
+  return (((unsigned int)data[0]) | (((unsigned int)data[1]) << 8) |
+          (((unsigned int)data[2]) << 16) | (((unsigned int)data[3]) << 24));
+}
+
+inline unsigned int BinaryIndexReader::getFunctionCount() const
+{
+  return _functionCount;
+}
@@ -0,0 +1,372 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// callgraph.cpp Builds the graph of which functions call which
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include "basetypes.h"
+#include "functwriter.h"
+#include "callgraph.h"
+
+using std::string;
+using std::vector;
+using std::endl;
+using std::ofstream;
+using std::ios_base;
+using std::sort;
+using std::lower_bound;
+using std::upper_bound;
+
+static const char GraphMagic[4] = { 'F', 'C', 'G', 'R' };
+/* Increase this whenever the layout changes, so old readers reject new
+   files instead of misreading them */
+static const unsigned int GraphVersion = 2;
+
+// Appends a number to the buffer, low byte first
+static void appendNumber(string& buffer, unsigned int value)
+{
+  buffer += (char)(value & 0xFF);
+  buffer += (char)((value >> 8) & 0xFF);
+  buffer += (char)((value >> 16) & 0xFF);
+  buffer += (char)((value >> 24) & 0xFF);
+}
+
+// Appends a list of numbers to the buffer
+static void appendNumbers(string& buffer, const vector<unsigned int>& values)
+{
+  unsigned int index;
+  buffer.reserve(buffer.length() + (values.size() * 4));
+  for (index = 0; index < values.size(); index++)
+    appendNumber(buffer, values[index]);
+}
+
+// Hash function object for node keys
+size_t CallGraph::NodeKeyHash::operator()(const NodeKey& value) const
+{
+  return (value.first.hash() * 31) ^ value.second.hash();
+}
+
+CallGraph::CallGraph()
+{
+}
+
+// Returns the number of a node, adding it if needed. The file is empty for global functions
+unsigned int CallGraph::findNodeId(const InternedString& name, const InternedString& file)
+{
+  NodeKey key(name, file);
+  NodeIds::const_iterator found = _nodeIds.find(key);
+  if (found != _nodeIds.end())
+    return found->second;
+  unsigned int id = _names.size();
+  _nodeIds[key] = id;
+  _names.push_back(name);
+  _files.push_back(file);
+  return id;
+}
+
+// Returns the node a call goes to, adding it if needed
+unsigned int CallGraph::findCallee(const Call& call, const StaticNodes& staticNodes)
+{
+  if (call.fileScope) {
+    NodeIds::const_iterator found = _nodeIds.find(NodeKey(call.name, call.file));
+    if (found != _nodeIds.end())
+      return found->second;
+    /* A static function defined in a header is found in the header, not the
+       file of the call. If it is the only one with the name, it must be it */
+    StaticNodes::const_iterator only = staticNodes.find(call.name);
+    if ((only != staticNodes.end()) && (only->second != _NoNode))
+      return only->second;
+  }
+  // Calls between files can only reach global functions
+  return findNodeId(call.name, InternedString());
+}
+
+// Returns the name of a node as output, with the file for static functions
+string CallGraph::nodeLabel(unsigned int node) const
+{
+  if (_files[node].empty())
+    return _names[node].str();
+  else
+    return _names[node].str() + " (" + _files[node].str() + ")";
+}
+
+void CallGraph::add(const FunctionData& data)
+{
+  if (data.isDeclaration())
+    findNodeId(data.getName(), data.isFileScope() ?
+                               data.getFilePosition().getInternedFileName() :
+                               InternedString());
+  // Calls outside any function, such as in initializers, have no caller
+  else if (!data.getCaller().empty()) {
+    Call call;
+    call.caller = data.getCaller();
+    call.name = data.getName();
+    call.file = data.getFilePosition().getInternedFileName();
+    call.fileScope = data.isFileScope();
+    _calls.push_back(call);
+  }
+}
+
+/* Fills compressed rows from edges given as source and target lists,
+   removing duplicates. Takes linear time besides sorting each row */
+void CallGraph::fillRows(const vector<unsigned int>& sources,
+                         const vector<unsigned int>& targets, unsigned int nodeCount,
+                         vector<unsigned int>& starts, vector<unsigned int>& rows)
+{
+  unsigned int index;
+  unsigned int node;
+
+  // Count the edges from each node, then place each one in its row
+  starts.assign(nodeCount + 1, 0);
+  for (index = 0; index < sources.size(); index++)
+    starts[sources[index] + 1]++;
+  for (node = 0; node < nodeCount; node++)
+    starts[node + 1] += starts[node];
+  vector<unsigned int> nextEdge(starts.begin(), starts.end() - 1);
+  rows.resize(sources.size());
+  for (index = 0; index < sources.size(); index++)
+    rows[nextEdge[sources[index]]++] = targets[index];
+
+  // Sort each row and drop duplicates, moving the rows down to close the gaps
+  unsigned int used = 0;
+  for (node = 0; node < nodeCount; node++) {
+    unsigned int first = starts[node];
+    unsigned int last = starts[node + 1];
+    sort(rows.begin() + first, rows.begin() + last);
+    starts[node] = used;
+    for (index = first; index < last; index++)
+      if ((used == starts[node]) || (rows[used - 1] != rows[index]))
+        rows[used++] = rows[index];
+  }
+  starts[nodeCount] = used;
+  rows.resize(used);
+}
+
+// Builds the graph from the functions added
+void CallGraph::build()
+{
+  unsigned int index;
+  unsigned int node;
+
+  // Every static function is known now, so the calls can be matched to them
+  StaticNodes staticNodes;
+  for (node = 0; node < _names.size(); node++)
+    if (!_files[node].empty()) {
+      pair<StaticNodes::iterator, bool> added =
+          staticNodes.insert(StaticNodes::value_type(_names[node], node));
+      if (!added.second)
+        added.first->second = _NoNode;
+    }
+  vector<Edge> edges;
+  edges.reserve(_calls.size());
+  for (index = 0; index < _calls.size(); index++) {
+    const Call& call = _calls[index];
+    NodeIds::const_iterator caller = _nodeIds.find(NodeKey(call.caller, call.file));
+    unsigned int callerId = (caller != _nodeIds.end()) ? caller->second :
+                            findNodeId(call.caller, InternedString());
+    edges.push_back(Edge(callerId, findCallee(call, staticNodes)));
+  }
+  vector<Call>().swap(_calls);
+
+  // Number the nodes in name order, then by file
+  vector<NodeKey> sorted;
+  sorted.reserve(_names.size());
+  for (node = 0; node < _names.size(); node++)
+    sorted.push_back(NodeKey(_names[node], _files[node]));
+  sort(sorted.begin(), sorted.end());
+  vector<unsigned int> newIds(_names.size());
+  for (index = 0; index < sorted.size(); index++) {
+    unsigned int& id = _nodeIds[sorted[index]];
+    newIds[id] = index;
+    id = index;
+    _names[index] = sorted[index].first;
+    _files[index] = sorted[index].second;
+  }
+
+  vector<unsigned int> sources;
+  vector<unsigned int> targets;
+  sources.reserve(edges.size());
+  targets.reserve(edges.size());
+  for (index = 0; index < edges.size(); index++) {
+    sources.push_back(newIds[edges[index].first]);
+    targets.push_back(newIds[edges[index].second]);
+  }
+  vector<Edge>().swap(edges);
+  fillRows(sources, targets, _names.size(), _forwardStart, _forwardEdges);
+
+  // The reverse rows come from the forward ones, which have no duplicates
+  sources.clear();
+  targets.clear();
+  for (node = 0; node < _names.size(); node++)
+    for (index = _forwardStart[node]; index < _forwardStart[node + 1]; index++) {
+      sources.push_back(_forwardEdges[index]);
+      targets.push_back(node);
+    }
+  fillRows(sources, targets, _names.size(), _reverseStart, _reverseEdges);
+}
+
+void CallGraph::clear()
+{
+  _nodeIds.clear();
+  _names.clear();
+  _files.clear();
+  _calls.clear();
+  _forwardStart.clear();
+  _forwardEdges.clear();
+  _reverseStart.clear();
+  _reverseEdges.clear();
+}
+
+/* Finds every function called directly or indirectly from the ones with the
+   given name, or if callers is set, every function that calls them directly
+   or indirectly */
+bool CallGraph::findReachable(const InternedString& name, bool callers,
+                              vector<string>& result) const
+{
+  result.clear();
+  if (_forwardStart.empty())
+    return false;
+  // Nodes are in name order, so the ones with the name are together
+  vector<InternedString>::const_iterator first = lower_bound(_names.begin(), _names.end(), name);
+  vector<InternedString>::const_iterator last = upper_bound(first, _names.end(), name);
+  if (first == last)
+    return false;
+  const vector<unsigned int>& starts = callers ? _reverseStart : _forwardStart;
+  const vector<unsigned int>& rows = callers ? _reverseEdges : _forwardEdges;
+
+  // Breadth first search. Each node is queued once, when first reached
+  vector<char> reached(_names.size(), false);
+  vector<unsigned int> queue;
+  unsigned int startCount = last - first;
+  unsigned int next;
+  unsigned int index;
+  for (index = first - _names.begin(); index < (unsigned int)(last - _names.begin()); index++)
+    queue.push_back(index);
+  for (next = 0; next < queue.size(); next++)
+    for (index = starts[queue[next]]; index < starts[queue[next] + 1]; index++)
+      if (!reached[rows[index]]) {
+        reached[rows[index]] = true;
+        queue.push_back(rows[index]);
+      }
+
+  // Node numbers follow name order. The first entries are the start points
+  sort(queue.begin() + startCount, queue.end());
+  for (index = startCount; index < queue.size(); index++)
+    result.push_back(nodeLabel(queue[index]));
+  return true;
+}
+
+/* Returns the label of a node as a quoted DOT string. File names come from
+   line markers, so they may hold quotes or backslashes */
+string CallGraph::dotLabel(unsigned int node) const
+{
+  string label = nodeLabel(node);
+  string result("\"");
+  string::size_type index;
+  for (index = 0; index < label.length(); index++) {
+    if ((label[index] == '"') || (label[index] == '\\'))
+      result += '\\';
+    result += label[index];
+  }
+  result += '"';
+  return result;
+}
+
+// Writes the graph in the DOT language used by Graphviz
+void CallGraph::writeDot(ostream& output) const
+{
+  unsigned int node;
+  unsigned int index;
+
+  output << "digraph calls {" << endl;
+  for (node = 0; node < _names.size(); node++)
+    output << "  " << dotLabel(node) << ";" << endl;
+  for (node = 0; node + 1 < _forwardStart.size(); node++)
+    for (index = _forwardStart[node]; index < _forwardStart[node + 1]; index++)
+      output << "  " << dotLabel(node) << " -> "
+             << dotLabel(_forwardEdges[index]) << ";" << endl;
+  output << "}" << endl;
+}
+
+// Writes the graph as JSON, with a list of names and one of edges between them
+void CallGraph::writeJson(ostream& output) const
+{
+  unsigned int node;
+  unsigned int index;
+
+  output << "{" << endl << "  \"nodes\": [";
+  for (node = 0; node < _names.size(); node++) {
+    string label;
+    FunctionWriter::appendJsonString(label, nodeLabel(node));
+    output << ((node > 0) ? ",\n    " : "\n    ") << label;
+  }
+  output << endl << "  ]," << endl << "  \"edges\": [";
+  bool first = true;
+  for (node = 0; node + 1 < _forwardStart.size(); node++)
+    for (index = _forwardStart[node]; index < _forwardStart[node + 1]; index++) {
+      output << (first ? "\n    [" : ",\n    [") << node << ", "
+             << _forwardEdges[index] << "]";
+      first = false;
+    }
+  output << endl << "  ]" << endl << "}" << endl;
+}
+
+// Writes the graph in binary form to the named file
+bool CallGraph::writeBinary(const string& fileName) const
+{
+  unsigned int node;
+
+  string stringTable;
+  string stringText;
+  for (node = 0; node < _names.size(); node++) {
+    appendNumber(stringTable, stringText.length());
+    stringText += _names[node].str();
+  }
+  for (node = 0; node < _files.size(); node++) {
+    appendNumber(stringTable, stringText.length());
+    stringText += _files[node].str();
+  }
+  appendNumber(stringTable, stringText.length());
+  stringText.append((4 - (stringText.length() % 4)) % 4, '\0');
+
+  string header(GraphMagic, sizeof(GraphMagic));
+  appendNumber(header, GraphVersion);
+  appendNumber(header, _names.size());
+  appendNumber(header, _forwardEdges.size());
+
+  string edges;
+  appendNumbers(edges, _forwardStart);
+  appendNumbers(edges, _forwardEdges);
+  appendNumbers(edges, _reverseStart);
+  appendNumbers(edges, _reverseEdges);
+
+  ofstream output(fileName.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+  output << header << stringTable << stringText << edges;
+  output.close();
+  return (bool)output;
+}
@@ -0,0 +1,154 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// callgraph.h Builds the graph of which functions call which
+using std::unordered_map;
+using std::pair;
+
+/* This object holds the call graph of a group of functions. Each function
+   is a node, and there is an edge from each function to every function it
+   calls or takes the refrence of. Global functions are one node per name, as
+   in the rest of the index, but each static function is its own node, named
+   by its file as well. Calls are matched to nodes as the linker would: a call
+   resolved within its file goes to the static function of that name in the
+   file, and any other call goes to the global function. A call from within a
+   function goes from the static function of that name in the file of the call
+   if there is one, otherwise from the global one.
+     Edges are stored in compressed sparse row form, both forward (callees of
+   each function) and reverse (callers). Each form is a list of targets
+   grouped by node, plus the start of each node's group, so the graph takes
+   two numbers per edge each way, and walking it touches memory in order.
+   Nodes are numbered in name order once the graph is built, with global
+   functions before static ones of the same name and statics in file order,
+   so every output is sorted by name.
+     Functions are added first, then the graph is built once. It must be
+   cleared before it can be built again */
+class CallGraph
+{
+ private:
+  static const unsigned int _NoNode = 0xFFFFFFFF;
+
+  typedef pair<InternedString, InternedString> NodeKey; // Name, then file for static functions
+
+  // Hash function object for node keys
+  struct NodeKeyHash
+  {
+    size_t operator()(const NodeKey& value) const;
+  };
+
+  typedef unordered_map<NodeKey, unsigned int, NodeKeyHash> NodeIds;
+  // The only static function node with each name, or _NoNode if there are several
+  typedef unordered_map<InternedString, unsigned int, InternedStringHash> StaticNodes;
+  typedef pair<unsigned int, unsigned int> Edge; // Caller, then function called
+
+  // A call, kept until the graph is built and every static function is known
+  struct Call
+  {
+    InternedString caller;
+    InternedString name;
+    InternedString file; // Where the call is
+    bool fileScope; // True, the call was resolved to a static function in its file
+  };
+
+  NodeIds _nodeIds;
+  vector<InternedString> _names; // Name of each node
+  vector<InternedString> _files; // File of each static function node, empty for global ones
+  vector<Call> _calls; // Added but not yet built, may have duplicates
+  vector<unsigned int> _forwardStart; // One entry per node, plus one more
+  vector<unsigned int> _forwardEdges;
+  vector<unsigned int> _reverseStart;
+  vector<unsigned int> _reverseEdges;
+
+  // Returns the number of a node, adding it if needed. The file is empty for global functions
+  unsigned int findNodeId(const InternedString& name, const InternedString& file);
+
+  // Returns the node a call goes to, adding it if needed
+  unsigned int findCallee(const Call& call, const StaticNodes& staticNodes);
+
+  // Returns the name of a node as output, with the file for static functions
+  string nodeLabel(unsigned int node) const;
+
+  /* Returns the label of a node as a quoted DOT string. File names come from
+     line markers, so they may hold quotes or backslashes */
+  string dotLabel(unsigned int node) const;
+
+  /* Fills compressed rows from edges given as source and target lists,
+     removing duplicates. Takes linear time besides sorting each row */
+  static void fillRows(const vector<unsigned int>& sources,
+                       const vector<unsigned int>& targets, unsigned int nodeCount,
+                       vector<unsigned int>& starts, vector<unsigned int>& rows);
+
+ public:
+  CallGraph();
+
+  // This object uses the default copy constructor, assignment operator, and destructor
+
+  void add(const FunctionData& data);
+
+  // Builds the graph from the functions added
+  void build();
+
+  void clear();
+
+  unsigned int getNodeCount() const;
+
+  unsigned int getEdgeCount() const;
+
+  /* Finds every function called directly or indirectly from the ones with the
+     given name, or if callers is set, every function that calls them directly
+     or indirectly. A function with the name is only included if it is reached
+     from one of them. Results are in name order, with static functions
+     followed by their file in parentheses. Returns false if no function with
+     the name is in the graph */
+  bool findReachable(const InternedString& name, bool callers,
+                     vector<string>& result) const;
+
+  // Writes the graph in the DOT language used by Graphviz
+  void writeDot(ostream& output) const;
+
+  // Writes the graph as JSON, with a list of names and one of edges between them
+  void writeJson(ostream& output) const;
+
+  /* Writes the graph in binary form to the named file. It must be built
+     first. Returns false if it can't be written. All numbers are four bytes, little endian:
+       header: "FCGR", format version, node count, edge count
+       string table: start of each name within the string text, then of the
+         file of each node (empty for global functions), plus one more entry
+         giving the end of the last one
+       string text: the names in node order and then the files, padded to
+         four bytes
+       forward starts: the first forward edge of each node, plus one more
+         entry giving the edge count
+       forward edges: the node called, for each edge
+       reverse starts and edges: the same, but giving callers */
+  bool writeBinary(const string& fileName) const;
+};
+
+inline unsigned int CallGraph::getNodeCount() const
+{
+  return _names.size();
+}
+
+inline unsigned int CallGraph::getEdgeCount() const
+{
+  return _forwardEdges.size();
+}
@@ -0,0 +1,211 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// diagnostics.cpp Writes out the warnings found while indexing
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "basetypes.h"
+#include "errors.h"
+#include "functwriter.h"
+#include "diagnostics.h"
+
+using std::string;
+using std::cout;
+
+// Writes plain text to standard output until told otherwise
+DiagnosticSink::DiagnosticSink()
+    : _output(&cout), _format(textFormat), _limited(false), _started(false),
+      _haveResult(false)
+{
+  unsigned int index;
+  for (index = 0; index < WarningCodeCount; index++) {
+    _limits[index] = (unsigned long)-1;
+    _counts[index] = 0;
+  }
+}
+
+// Writes no more than the given number of warnings with the code. Zero hides them
+void DiagnosticSink::setLimit(WarningCode code, unsigned long count)
+{
+  _limits[code] = count;
+  _limited = true;
+}
+
+// Writes the warnings in the log text
+void DiagnosticSink::write(const string& log)
+{
+  string::size_type start = 0;
+  string::size_type end;
+  // Logs are normally whole lines, but a line may be split between two of them
+  if (!_partial.empty()) {
+    end = log.find('\n');
+    if (end == string::npos) {
+      _partial += log;
+      return;
+    }
+    _partial.append(log, 0, end);
+    writeLine(_partial);
+    _partial.clear();
+    start = end + 1;
+  }
+  while ((end = log.find('\n', start)) != string::npos) {
+    writeLine(log.substr(start, end - start));
+    start = end + 1;
+  }
+  if (start < log.length())
+    _partial.assign(log, start, string::npos);
+}
+
+// Writes one line of the logs
+void DiagnosticSink::writeLine(const string& line)
+{
+  string::size_type marks[4];
+  string::size_type start = 0;
+  unsigned int index;
+  WarningCode code = WarningCodeCount;
+
+  for (index = 0; index < 4; index++) {
+    marks[index] = line.find(WarningFieldMark, start);
+    if (marks[index] == string::npos)
+      break;
+    start = marks[index] + 1;
+  }
+  if (index == 4)
+    code = findWarningCode(line.substr(0, marks[0]));
+  if (code == WarningCodeCount)
+    writeWarning(code, string(), string(), string(), line);
+  else {
+    _counts[code]++;
+    if (_counts[code] <= _limits[code])
+      writeWarning(code, line.substr(marks[0] + 1, marks[1] - marks[0] - 1),
+                   line.substr(marks[1] + 1, marks[2] - marks[1] - 1),
+                   line.substr(marks[2] + 1, marks[3] - marks[2] - 1),
+                   line.substr(marks[3] + 1));
+  }
+}
+
+// Writes a warning, or text with no code if code is WarningCodeCount
+void DiagnosticSink::writeWarning(WarningCode code, const string& fileName,
+                                  const string& lineNo, const string& lexeme,
+                                  const string& text)
+{
+  static const string warningLead("WARNING: ");
+  if (_format == textFormat) {
+    *_output << text << '\n';
+    return;
+  }
+  if (text.empty() && (code == WarningCodeCount))
+    return; // Blank lines only separate plain text
+  // The formats below have their own way of marking a warning
+  string message(text);
+  if (message.compare(0, warningLead.length(), warningLead) == 0)
+    message.erase(0, warningLead.length());
+  // Files named by the preprocessor have no line
+  bool haveLine = (!lineNo.empty()) && (lineNo != "0");
+
+  if (_format == jsonFormat) {
+    *_output << '{';
+    if (code != WarningCodeCount) {
+      *_output << "\"code\":\"" << warningCodeName(code) << "\",\"file\":";
+      writeJsonString(fileName);
+      if (haveLine)
+        *_output << ",\"line\":" << lineNo;
+      if (!lexeme.empty()) {
+        *_output << ",\"token\":";
+        writeJsonString(lexeme);
+      }
+      *_output << ',';
+    }
+    *_output << "\"message\":";
+    writeJsonString(message);
+    *_output << "}\n";
+    return;
+  }
+
+  startSarif();
+  if (_haveResult)
+    *_output << ',';
+  _haveResult = true;
+  *_output << "\n{";
+  if (code != WarningCodeCount)
+    *_output << "\"ruleId\":\"" << warningCodeName(code) << "\",\"level\":\"warning\",";
+  else
+    *_output << "\"level\":\"note\",";
+  *_output << "\"message\":{\"text\":";
+  writeJsonString(message);
+  *_output << '}';
+  if ((code != WarningCodeCount) && (!fileName.empty())) {
+    *_output << ",\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+    writeJsonString(fileName);
+    *_output << '}';
+    if (haveLine)
+      *_output << ",\"region\":{\"startLine\":" << lineNo << '}';
+    *_output << "}}]";
+  }
+  *_output << '}';
+}
+
+// Writes the start of a SARIF file, unless already written
+void DiagnosticSink::startSarif()
+{
+  if (_started)
+    return;
+  // One run of one tool, holding every warning
+  *_output << "{\"version\":\"2.1.0\","
+           << "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+           << "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"ProgramIndexer\"}},\n"
+           << "\"results\":[";
+  _started = true;
+}
+
+// Writes the text as a JSON string
+void DiagnosticSink::writeJsonString(const string& text)
+{
+  string quoted;
+  FunctionWriter::appendJsonString(quoted, text);
+  *_output << quoted;
+}
+
+/* Ends the output. As plain text, reports how many warnings were hidden by
+   the limits */
+void DiagnosticSink::finish()
+{
+  unsigned int index;
+  if (!_partial.empty()) {
+    writeLine(_partial);
+    _partial.clear();
+  }
+  if ((_format == textFormat) && _limited)
+    for (index = 0; index < WarningCodeCount; index++)
+      if (_counts[index] > _limits[index])
+        *_output << (_counts[index] - _limits[index]) << " warnings of kind "
+                 << warningCodeName((WarningCode)index) << " not shown" << '\n';
+  if (_format == sarifFormat) {
+    startSarif();
+    *_output << "\n]}]}\n";
+    _started = false;
+    _haveResult = false;
+  }
+  _output->flush();
+}
@@ -0,0 +1,98 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// diagnostics.h Writes out the warnings found while indexing
+
+/* Warnings are written to the log streams as records (see errors.h), and the
+   logs are kept as text a file at a time, so they come out in file order no
+   matter how many threads did the indexing. This object takes the logs in that
+   order and writes the warnings in them as plain text, as JSON with one object
+   per line, or as a SARIF file for tools that read it. It can also limit how
+   many warnings of each kind are written, to hide noisy ones. Nothing is
+   flushed until the output ends, so writing warnings costs little.
+     Text in the logs which is not a record, such as from an older cache, is
+   written as it is, or as a message with no code */
+class DiagnosticSink
+{
+ public:
+  typedef enum { textFormat, jsonFormat, sarifFormat } Format;
+
+ private:
+  ostream* _output;
+  Format _format;
+  unsigned long _limits[WarningCodeCount]; // Most warnings written for each code
+  unsigned long _counts[WarningCodeCount]; // Warnings found for each code
+  bool _limited; // True, some code has a limit
+  string _partial; // Text after the last complete line of the logs
+  bool _started; // True, the start of the output has been written
+  bool _haveResult; // True, a warning has been written to a SARIF file
+
+  // Writes one line of the logs
+  void writeLine(const string& line);
+
+  // Writes a warning, or text with no code if code is WarningCodeCount
+  void writeWarning(WarningCode code, const string& fileName,
+                    const string& lineNo, const string& lexeme,
+                    const string& text);
+
+  // Writes the start of a SARIF file, unless already written
+  void startSarif();
+
+  // Writes the text as a JSON string
+  void writeJsonString(const string& text);
+
+  // Copy constructor and assignment operator. This object can't be copied
+  DiagnosticSink(const DiagnosticSink& other);
+  const DiagnosticSink& operator=(const DiagnosticSink& other);
+
+ public:
+  // Writes plain text to standard output until told otherwise
+  DiagnosticSink();
+
+  // Sets where the warnings are written
+  void setOutput(ostream& output);
+
+  // Sets the format the warnings are written in
+  void setFormat(Format format);
+
+  // Writes no more than the given number of warnings with the code. Zero hides them
+  void setLimit(WarningCode code, unsigned long count);
+
+  // Writes the warnings in the log text
+  void write(const string& log);
+
+  /* Ends the output. As plain text, reports how many warnings were hidden by
+     the limits */
+  void finish();
+};
+
+// Sets where the warnings are written
+inline void DiagnosticSink::setOutput(ostream& output)
+{
+  _output = &output;
+}
+
+// Sets the format the warnings are written in
+inline void DiagnosticSink::setFormat(DiagnosticSink::Format format)
+{
+  _format = format;
+}
@@ -36,6 +36,8 @@ using std::strncpy;
 NoSuchFileException::NoSuchFileException(const string &fileName)
 {
   strncpy(_message, "Could not open file ", _MessageSize - _FileNameSize - 1);
+  // The copy above fills the space exactly, so it does not terminate the string
+  _message[_MessageSize - _FileNameSize - 1] = '\0';
   /* If the file name (which may include the full path) is smaller than
     the space available, just copy it. Otherwise, try to remove the path
     and just use the filename. Note that a standard string substring can't
@@ -44,7 +46,7 @@ NoSuchFileException::NoSuchFileException(const string &fileName)
   if (fileName.length() < _FileNameSize)
     strncat(_message, fileName.c_str(), _FileNameSize);
   else {
-    unsigned int startPos = fileName.find_last_of('/');
+    size_t startPos = fileName.find_last_of('/');
     if (startPos == string::npos)
         startPos = 0; // No directory information
     else if ((fileName.length() - startPos) < _FileNameSize)
@@ -65,10 +67,50 @@ DouFuncRelException::DouFuncRelException()
   _message[_MessageSize - 1] = '\0'; // Ensure string is terminated
 }
 
+// Names of the warning codes, in the order of the enum
+static const char* const _warningCodeNames[WarningCodeCount] = {
+  "unterminated-string", "preprocessor-directive", "processing-error",
+  "unmatched-prototype", "shadowed-name", "reused-name", "missing-prototype",
+  "duplicate-declaration", "duplicate-prototype", "static-after-prototype",
+  "prototype-after-declaration", "incomplete-declaration", "nested-function",
+  "struct-call", "incomplete-call", "duplicate-global", "static-global",
+  "static-call"
+};
+
+// Returns the name of the warning code
+const char* warningCodeName(WarningCode code)
+{
+  return _warningCodeNames[code];
+}
+
+// Returns the code with the given name, or WarningCodeCount if there is none
+WarningCode findWarningCode(const string& name)
+{
+  unsigned int index;
+  for (index = 0; index < WarningCodeCount; index++)
+    if (name == _warningCodeNames[index])
+      break;
+  return (WarningCode)index;
+}
+
+/* Starts a warning record on the stream. The caller writes the text of the
+   warning after it, and ends the line */
+ostream& startWarning(ostream& stream, WarningCode code,
+                      const FilePosition& position, const string& lexeme)
+{
+  return stream << _warningCodeNames[code] << WarningFieldMark
+                << position.getFileName() << WarningFieldMark
+                << position.getLineNo() << WarningFieldMark
+                << lexeme << WarningFieldMark;
+}
+
 // Logs a token for error reporting purposes
-void logTokenError(ostream& stream, const Token& token, const string& leadText,
-                   const string& trailText)
+void logTokenError(ostream& stream, WarningCode code, const Token& token,
+                   const string& leadText, const string& trailText)
 {
-  stream << "WARNING: " << leadText << token.getLexeme() << " found "
-         << token.getFilePosition() << trailText << endl;
+  /* Not flushed, the logs are written out a file at a time. See
+     diagnostics.h */
+  startWarning(stream, code, token.getFilePosition(), token.getLexeme())
+    << "WARNING: " << leadText << token.getLexeme() << " found "
+    << token.getFilePosition() << trailText << '\n';
 }
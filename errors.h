@@ -25,9 +25,35 @@
 
 using std::exception;
 
+/* Kinds of warnings, so they can be counted, limited, and output in other
+   formats. The names used for them are given by warningCodeName() */
+typedef enum { unterminatedString, preprocDirective, processingError,
+               unmatchedPrototype, shadowedName, reusedName, missingPrototype,
+               duplicateDeclaration, duplicatePrototype, staticAfterPrototype,
+               prototypeAfterDeclaration, incompleteDeclaration, nestedFunction,
+               structCall, incompleteCall, duplicateGlobal, staticGlobal,
+               staticCall, WarningCodeCount } WarningCode;
+
+/* Warnings are written to the log streams as records, one per line. The code,
+   source file, line number, and token come first, each followed by this char,
+   then the text of the warning. Whatever outputs the logs turns the records
+   into the wanted format, see diagnostics.h */
+const char WarningFieldMark = '\x1f';
+
+// Returns the name of the warning code
+const char* warningCodeName(WarningCode code);
+
+// Returns the code with the given name, or WarningCodeCount if there is none
+WarningCode findWarningCode(const string& name);
+
+/* Starts a warning record on the stream. The caller writes the text of the
+   warning after it, and ends the line */
+ostream& startWarning(ostream& stream, WarningCode code,
+                      const FilePosition& position, const string& lexeme);
+
 // Logs a token for error reporting purposes
-void logTokenError(ostream& stream, const Token& token, const string& leadText,
-                   const string& trailText);
+void logTokenError(ostream& stream, WarningCode code, const Token& token,
+                   const string& leadText, const string& trailText);
 
 // Exception for missing file
 class NoSuchFileException: public exception
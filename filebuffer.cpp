@@ -24,26 +24,67 @@
 
 #include<fstream>
 #include<iostream>
+#include<sstream>
 #include<string>
+#include<chrono>
 #include<vector>
+#include<utility>
+#include<atomic>
+#include<thread>
 #include<cstdlib>
+#include<cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include<sys/types.h>
+#include<sys/stat.h>
+#include<sys/mman.h>
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+#if defined(__AVX2__) && !defined(INDEX_SCALAR_SCAN)
+#include<immintrin.h>
+#elif defined(__SSE2__) && !defined(INDEX_SCALAR_SCAN)
+#include<emmintrin.h>
+#endif
+#include<unordered_map>
+#include<mutex>
+#include<condition_variable>
 #include"basetypes.h"
+#include"indexstats.h"
 #include"filebuffer.h"
+#include"spscqueue.h"
 #include"errors.h"
+#include"regionfilter.h"
+#include"headercache.h"
 
 using std::ifstream;
 using std::string;
 using std::atoi;
 using std::cout;
-using std::endl;
+using std::vector;
+using std::ostringstream;
+using std::hex;
 
 FileBuffer::FileBuffer()
-    : _sourcePosition("", 0), _bufferPosition("", 0),
-      _inputPosition("", 0) // No file yet
+    : _copyFiles(false), _sourcePosition("", 0), _bufferPosition("", 0),
+      _inputPosition("", 0), // No file yet
+      _log(&cout), _markerFlags(false), _headerCache(NULL)
 {
     resetVars();
 }
 
+// Closes the filebuffer
+void FileBuffer::close()
+{
+  if (_file.is_open())
+    _file.close();
+#ifdef HAVE_MMAP
+  if ((_mapData != NULL) && (!_isCopy))
+    munmap(const_cast<char*>(_mapData), _mapSize);
+#endif
+  resetVars();
+}
+
 // Destructor.
 FileBuffer::~FileBuffer()
 {
@@ -52,23 +93,308 @@ FileBuffer::~FileBuffer()
 
 /* Opens the given file. Second parameter tells whether to search system dirs
    Throws a file not found exception if can't find the file */
-void FileBuffer::open(string fileName)
+void FileBuffer::open(const string& fileName)
 {
   // Close old file (if any) before attempting to process a new one
   close();
-  _file.open(fileName.c_str());
-  if (!_file.is_open())
-    throw NoSuchFileException(fileName);
+  if (!mapFile(fileName)) {
+    _file.open(fileName.c_str());
+    if (!_file.is_open())
+      throw NoSuchFileException(fileName);
+  }
+  _haveFileEOF = false;
+  _sourcePosition = FilePosition(fileName, 0);
+  _bufferPosition = _sourcePosition;
+  _inputPosition = _sourcePosition;
+  _buffer.clear();
+  // Load first buffer, fetch is a lookahead
+  fetchNextLine();
+}
+
+/* Opens the buffer on lines read from the named file by another buffer,
+   usually on another thread */
+void FileBuffer::open(const string& fileName, LineQueue& lines)
+{
+  close();
+  _feed = &lines;
+  _feedBatch.clear();
+  _haveFileEOF = false;
+  _sourcePosition = FilePosition(fileName, 0);
+  _bufferPosition = _sourcePosition;
+  _inputPosition = _sourcePosition;
+  _buffer.clear();
+  fetchNextLine();
+}
+
+/* Moves lines from the file into the batch for another buffer to return,
+   up to the given count, along with the warnings issued reading them */
+void FileBuffer::readLines(LineBatch& batch, unsigned int maxLines)
+{
+  /* The buffer always holds the next line, read ahead. Record it, then read
+     the one after, keeping any warnings for the line where they were issued */
+  ostringstream lineLog;
+  ostream* oldLog = _log;
+  _log = &lineLog;
+  batch.clear();
+  while ((!batch.last) && (batch.lines.size() < maxLines)) {
+    batch.text.append(_bufferData, _bufferLength);
+    batch.log += _lineWarnings;
+    _lineWarnings.clear();
+    LineBatch::Line line = { batch.text.length(), batch.log.length(),
+                             _bufferPosition, _haveFileEOF };
+    batch.lines.push_back(line);
+    if (haveEOF())
+      batch.last = true;
+    else {
+      fetchNextLine();
+      if (lineLog.tellp() > 0) {
+        _lineWarnings = lineLog.str();
+        lineLog.str("");
+      }
+    }
+  }
+  _log = oldLog;
+}
+
+// Takes the next line to tokenize from the feed instead of the file
+void FileBuffer::fetchFedLine()
+{
+  if (_feedLine >= _feedBatch.lines.size()) {
+    // A stopped feed ends the file early
+    if (_feedBatch.last || (!_feed->pop(_feedBatch))) {
+      _bufferLength = 0;
+      _haveFileEOF = true;
+      return;
+    }
+    _feedLine = 0;
+  }
+  const LineBatch::Line& line = _feedBatch.lines[_feedLine];
+  size_t textStart = 0;
+  size_t logStart = 0;
+  if (_feedLine > 0) {
+    textStart = _feedBatch.lines[_feedLine - 1].textEnd;
+    logStart = _feedBatch.lines[_feedLine - 1].logEnd;
+  }
+  _bufferData = _feedBatch.text.data() + textStart;
+  _bufferLength = line.textEnd - textStart;
+  _bufferPosition = line.position;
+  _haveFileEOF = line.fileEOF;
+  if (line.logEnd > logStart)
+    _log->write(_feedBatch.log.data() + logStart, line.logEnd - logStart);
+  _feedLine++;
+}
+
+/* Maps the named file into memory, or copies it there if set to copy files.
+   Returns false if it can't be mapped */
+bool FileBuffer::mapFile(const string& fileName)
+{
+#ifdef HAVE_MMAP
+  struct stat fileStats;
+  /* Only regular files can be mapped. Pipes and the like are read normally.
+     Check before opening, since opening and closing a pipe here would cut
+     off its writer before the stream opens it again */
+  if ((stat(fileName.c_str(), &fileStats) != 0) || (!S_ISREG(fileStats.st_mode)))
+    return false;
+  int fileDesc = ::open(fileName.c_str(), O_RDONLY);
+  if (fileDesc < 0)
+    return false;
+  // The file may have been replaced in between
+  if ((fstat(fileDesc, &fileStats) != 0) || (!S_ISREG(fileStats.st_mode))) {
+    ::close(fileDesc);
+    return false;
+  }
+  _mapSize = fileStats.st_size;
+  if (_copyFiles) {
+    // The file may shrink before it is all read, so use what was read
+    size_t readSize = 0;
+    ssize_t count = 1;
+    _fileCopy.resize(_mapSize);
+    while ((readSize < _mapSize) && (count > 0)) {
+      count = ::read(fileDesc, &_fileCopy[readSize], _mapSize - readSize);
+      if (count > 0)
+        readSize += count;
+    }
+    _fileCopy.resize(readSize);
+    _mapSize = readSize;
+    _mapData = _fileCopy.data();
+    _isCopy = true;
+  }
+  else if (_mapSize > 0) { // Empty files can't be mapped, but have nothing to read anyway
+    void* mapping = mmap(NULL, _mapSize, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fileDesc);
+      _mapSize = 0;
+      return false;
+    }
+    // The file is read start to finish exactly once
+    madvise(mapping, _mapSize, MADV_SEQUENTIAL);
+    _mapData = static_cast<const char*>(mapping);
+  }
+  ::close(fileDesc); // The mapping remains after the file is closed
+  _mapPos = 0;
+  _isMapped = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Reads the next raw line from the file
+void FileBuffer::readLine()
+{
+  if (!_isMapped) {
+    getline(_file, _lineText);
+    _lineData = _lineText.data();
+    _lineLength = _lineText.length();
+    _haveFileEOF = _file.eof();
+  }
   else {
-    _sourcePosition = FilePosition(fileName, 0);
-    _bufferPosition = _sourcePosition;
-    _inputPosition = _sourcePosition;
-    _buffer.clear();
-    // Load first buffer, fetch is a lookahead
-    fetchNextLine();
+    /* Must match getline() exactly. Reading the final newline does not set EOF;
+       that happens on the next read, which returns an empty line */
+    _lineData = _mapData + _mapPos;
+    const char* lineEnd = NULL;
+    if (_mapPos < _mapSize)
+      lineEnd = static_cast<const char*>(memchr(_lineData, '\n', _mapSize - _mapPos));
+    if (lineEnd == NULL) {
+      _lineLength = _mapSize - _mapPos;
+      _mapPos = _mapSize;
+      _haveFileEOF = true;
+    }
+    else {
+      _lineLength = lineEnd - _lineData;
+      _mapPos += _lineLength + 1;
+    }
   }
 }
 
+// Returns true if the char can change the text state of a line
+static inline bool isSpecialChar(char test)
+{
+  return ((test == '"') || (test == '\'') || (test == '/') || (test == '*') ||
+          (test == '\\') || (test == '#'));
+}
+
+// Returns the position of the lowest set bit in a non-zero value
+static inline unsigned int lowestBit(unsigned long long bits)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(bits);
+#else
+  unsigned int result = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    result++;
+  }
+  return result;
+#endif
+}
+
+// Marks the chars of the last line read that may change the text state
+void FileBuffer::scanLine()
+{
+  _specialChars.assign((_lineLength + 63) / 64, 0);
+  size_t index = 0;
+  /* Compare a block of chars against each special char at once, and turn the
+     results into one bit per char. Blocks divide evenly into 64 bits, so
+     each one falls within a single entry */
+#if defined(__AVX2__) && !defined(INDEX_SCALAR_SCAN)
+  const __m256i doubleQuote = _mm256_set1_epi8('"');
+  const __m256i singleQuote = _mm256_set1_epi8('\'');
+  const __m256i slash = _mm256_set1_epi8('/');
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i hash = _mm256_set1_epi8('#');
+  for (; (index + 32) <= _lineLength; index += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_lineData + index));
+    __m256i found = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, doubleQuote),
+                                        _mm256_cmpeq_epi8(block, singleQuote)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(block, slash),
+                                        _mm256_cmpeq_epi8(block, star))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, backslash),
+                        _mm256_cmpeq_epi8(block, hash)));
+    unsigned long long bits = _mm256_movemask_epi8(found) & 0xFFFFFFFFULL;
+    _specialChars[index / 64] |= bits << (index % 64);
+  }
+#elif defined(__SSE2__) && !defined(INDEX_SCALAR_SCAN)
+  const __m128i doubleQuote = _mm_set1_epi8('"');
+  const __m128i singleQuote = _mm_set1_epi8('\'');
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i hash = _mm_set1_epi8('#');
+  for (; (index + 16) <= _lineLength; index += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_lineData + index));
+    __m128i found = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, doubleQuote),
+                                  _mm_cmpeq_epi8(block, singleQuote)),
+                     _mm_or_si128(_mm_cmpeq_epi8(block, slash),
+                                  _mm_cmpeq_epi8(block, star))),
+        _mm_or_si128(_mm_cmpeq_epi8(block, backslash),
+                     _mm_cmpeq_epi8(block, hash)));
+    unsigned long long bits = _mm_movemask_epi8(found) & 0xFFFFULL;
+    _specialChars[index / 64] |= bits << (index % 64);
+  }
+#endif
+  // Whatever is left over, or everything if there is no vector support or
+  // INDEX_SCALAR_SCAN is defined
+  for (; index < _lineLength; index++)
+    if (isSpecialChar(_lineData[index]))
+      _specialChars[index / 64] |= 1ULL << (index % 64);
+}
+
+/* Returns the position of the next char of the last line read at or after
+   the given position, which matches the given one. Only chars marked by
+   scanLine() can be found. Returns string::npos if there are none */
+size_t FileBuffer::nextSpecialChar(char wanted, size_t startPos) const
+{
+  if (startPos >= _lineLength)
+    return string::npos;
+  size_t word = startPos / 64;
+  // Ignore chars before the start
+  unsigned long long bits = _specialChars[word] & ((~0ULL) << (startPos % 64));
+  while (true) {
+    while (bits != 0) {
+      size_t pos = (word * 64) + lowestBit(bits);
+      if (_lineData[pos] == wanted)
+        return pos;
+      bits &= bits - 1; // Clears the lowest bit
+    }
+    word++;
+    if (word >= _specialChars.size())
+      return string::npos;
+    bits = _specialChars[word];
+  }
+}
+
+// As above, but finds the next place the two chars appear together
+size_t FileBuffer::nextSpecialPair(char first, char second,
+                                   size_t startPos) const
+{
+  size_t pos = nextSpecialChar(first, startPos);
+  while ((pos != string::npos) &&
+         (((pos + 1) >= _lineLength) || (_lineData[pos + 1] != second)))
+    pos = nextSpecialChar(first, pos + 1);
+  return pos;
+}
+
+// Returns true if the last line read needs no processing
+bool FileBuffer::havePlainLine() const
+{
+  /* The line is used as is if it is outside of any comment, quote, or
+     preprocessor command, and it will not start one of them */
+  if (_currState != other)
+    return false;
+  size_t index = 0;
+  while ((index < _lineLength) &&
+         ((_lineData[index] == ' ') || (_lineData[index] == '\t')))
+    index++;
+  if ((index < _lineLength) && (_lineData[index] == '#'))
+    return false;
+  return ((nextSpecialChar('"', index) == string::npos) &&
+          (nextSpecialPair('/', '*', index) == string::npos));
+}
+
 // Reads the next line to tokenize from the file.
 void FileBuffer::fetchNextLine()
 {
@@ -85,23 +411,67 @@ void FileBuffer::fetchNextLine()
      may cover multiple lines, a condition called wrap. This
      hsa special handling depending on the category */
   TextState nextState = other;
-  string fileDataLine; // Actual data from the file
-  unsigned int start; // Start of next group of chars to process
-  unsigned int end; // End of next group of chars to process
+  size_t start; // Start of next group of chars to process
+  size_t end; // End of next group of chars to process
+  if (_feed != NULL) {
+    fetchFedLine();
+    return;
+  }
+  STATS_TIMER(lineStage);
 
   _buffer.clear();
-  while (_buffer.empty() && (!_file.eof())) {
+  _bufferLength = 0;
+  while ((_bufferLength == 0) && (!_haveFileEOF)) {
+    // The parser stores what an excluded region declares once it ends
+    if ((_regionEnd != 0) && (_mapPos >= _regionEnd)) {
+        _regionEnd = 0;
+        _buffer.assign(1, (char)regionEndMark);
+        _bufferData = _buffer.data();
+        _bufferLength = _buffer.length();
+        continue;
+    }
+
     // load another line from the file and process it
-    getline(_file, fileDataLine);
+    readLine();
+    scanLine();
+    STATS_COUNT(lines, 1);
+    STATS_COUNT(bytes, _lineLength + 1); // Include the newline
     _bufferPosition.incrLine();
     _inputPosition.incrLine();
+
+    /* Optimization: Most lines are entirely other text. These are returned
+        straight from the file data, without copying them. The result is the
+        same as processing them below, including ignoring blank lines */
+    if (havePlainLine()) {
+        _haveWrap = true;
+        size_t firstChar = 0;
+        while ((firstChar < _lineLength) &&
+               ((_lineData[firstChar] == ' ') || (_lineData[firstChar] == '\t')))
+            firstChar++;
+        size_t lastChar = _lineLength;
+        while ((lastChar > firstChar) &&
+               ((_lineData[lastChar - 1] == ' ') || (_lineData[lastChar - 1] == '\t')))
+            lastChar--;
+        // Blank, or nothing but an escaped newline
+        if ((firstChar < _lineLength) &&
+            ((_lineData[firstChar] != '\\') || (lastChar != (firstChar + 1)))) {
+            _bufferData = _lineData;
+            _bufferLength = _lineLength;
+        }
+        continue;
+    }
+
+    // Line needs processing, so need a copy of it
+    if (_isMapped)
+        _lineText.assign(_lineData, _lineLength);
+    const string& fileDataLine = _lineText; // Actual data from the file
     start = 0;
     end = 0;
     /* If the current status is 'other', this line
         may be a preprocessor line. It's signaled by the first
         non-space being a hash */
     if (_currState == other) {
-        unsigned int firstChar = burnSpaces(fileDataLine);
+        size_t firstChar = burnSpaces(fileDataLine);
         if (firstChar != string::npos)
             if (fileDataLine.at(firstChar) == '#') {
                 _currState = preproc;
@@ -117,7 +487,7 @@ void FileBuffer::fetchNextLine()
                 '/*' that indicates the start of the comment */
             if (!_haveWrap)
                 end += 2;
-            end = fileDataLine.find("*/", end);
+            end = nextSpecialPair('*', '/', end);
             _haveWrap = (end == string::npos); // Comment wraps
             if (!_haveWrap) {
                 end+=2; /* Search routine returns first char of close comment,
@@ -133,7 +503,7 @@ void FileBuffer::fetchNextLine()
                 did not wrap, need to skip over the opening quote */
             if (!_haveWrap)
                 end += 1;
-            end = nextCloseQuote(fileDataLine, end);
+            end = nextLineCloseQuote(fileDataLine, end);
             _haveWrap = (end == string::npos);
             if (_haveWrap) {
                 _buffer.append(fileDataLine, start, string::npos);
@@ -141,8 +511,9 @@ void FileBuffer::fetchNextLine()
                     either the quote or the escape was left out. GCC assumes the
                     latter, so this code does too. */
                 if (!hasEscNewline(_buffer, true)) {
-                    cout << "WARNING: Unterminated string literal found at "
-                         << _bufferPosition << endl;
+                    startWarning(*_log, unterminatedString, _bufferPosition, "")
+                        << "WARNING: Unterminated string literal found at "
+                        << _bufferPosition << '\n';
                     // Insert a backslash into the output. Note that it must be escaped
                     _buffer.append("\\");
                 } // Multi-line quote without escaped newline at end
@@ -169,8 +540,8 @@ void FileBuffer::fetchNextLine()
                 The section ends at the earlier of the two. If it contains at least
                 one char, copy them over */
             _haveWrap = false;
-            unsigned int nextQuote = nextOpenQuote(fileDataLine, start);
-            unsigned int nextComment = fileDataLine.find("/*", start);
+            size_t nextQuote = nextOpenQuote(fileDataLine, start);
+            size_t nextComment = nextSpecialPair('/', '*', start);
             if ((nextQuote == string::npos) &&
                 (nextComment == string::npos)) {
                 end = string::npos;
@@ -208,16 +579,18 @@ void FileBuffer::fetchNextLine()
          TRICKY NOTE: A quoted string of all whitespace must contain
          at least one character, either a quote or a backslash in front
          of the line end */
-    unsigned int testChar = burnSpaces(_buffer);
+    size_t testChar = burnSpaces(_buffer);
     if ((testChar == string::npos) ||
         ((testChar == getEscNewline(_buffer, false)) &&
          ((!_haveWrap) || (_currState != quote))))
         _buffer.clear();
+    _bufferData = _buffer.data();
+    _bufferLength = _buffer.length();
     } // While not found data to process and data still in the file
 }
 
 // Handle preprocessor comamnds in the input
-void FileBuffer::handlePreproc(string fileDataLine)
+void FileBuffer::handlePreproc(const string& fileDataLine)
 {
     /*Thanks to the preprocessor step, the location of text in
         the input file rarely matches that in the source file, but
@@ -242,8 +615,8 @@ void FileBuffer::handlePreproc(string fileDataLine)
     // Locations never wrap
     if ((!wasWrapped) && (!_haveWrap)) {
         // Find the line number
-        unsigned short start = 0;
-        unsigned short end = 0;
+        size_t start = 0;
+        size_t end = 0;
         start = fileDataLine.find_first_of('#');
         start = burnSpaces(fileDataLine, start + 1); // Actual text of command
         if (start != string::npos) { // Something on line other than hash
@@ -275,12 +648,19 @@ void FileBuffer::handlePreproc(string fileDataLine)
                                     end++;
                                     if (end != fileDataLine.length()) {
                                         end = burnSpaces(fileDataLine, end);
-                                        haveLocation = (end == string::npos);
+                                        /* gcc follows the name with flags, such as 3
+                                            for a system header. Accept them if wanted */
+                                        haveLocation = ((end == string::npos) ||
+                                                        (_markerFlags &&
+                                                         (fileDataLine.find_first_not_of(" \t1234", end) == string::npos)));
                                     } // Quote not last char on the line
                                     else
                                         haveLocation = true;
-                                    if (haveLocation)
+                                    if (haveLocation) {
                                         _bufferPosition = FilePosition(fileName, lineNo);
+                                        if (_headerCache != NULL)
+                                            startRegion(fileName, lineNo + 1);
+                                    }
                                 } // Have at least one char between quotes
                             } // Quote at end of filename exists
                         } // Quote at start of filename exists
@@ -291,19 +671,129 @@ void FileBuffer::handlePreproc(string fileDataLine)
     } // Preprocessor command did not wrap
 
     /* If a file location was no found, this is an actual preprocessor command
-        which indicates a processing error */
-    if ((!haveLocation) && (!wasWrapped))
-        cout << "WARNING: Preprocessor directive " << fileDataLine << " ignored on "
-             << _inputPosition << ". Must g++ -E source files before calling" << endl;
+        which indicates a processing error. Cached regions are never read, so
+        for the same results nothing is reported for the others either */
+    if ((!haveLocation) && (!wasWrapped) && (_regionEnd == 0))
+        startWarning(*_log, preprocDirective, _inputPosition, "")
+            << "WARNING: Preprocessor directive " << fileDataLine << " ignored on "
+            << _inputPosition << ". Must g++ -E source files before calling" << '\n';
+}
+
+/* If the raw line is a line marker, sets the file it names and returns true.
+   This is only a quick check for the markers within excluded regions */
+static bool markerFileName(const char* line, size_t length, string& fileName)
+{
+  size_t index = 0;
+  while ((index < length) && ((line[index] == ' ') || (line[index] == '\t')))
+    index++;
+  if ((index >= length) || (line[index] != '#'))
+    return false;
+  index++;
+  while ((index < length) && ((line[index] == ' ') || (line[index] == '\t')))
+    index++;
+  size_t digits = index;
+  while ((index < length) && (line[index] >= '0') && (line[index] <= '9'))
+    index++;
+  if (index == digits)
+    return false;
+  while ((index < length) && ((line[index] == ' ') || (line[index] == '\t')))
+    index++;
+  if ((index >= length) || (line[index] != '"'))
+    return false;
+  index++;
+  const char* nameEnd = static_cast<const char*>(memchr(line + index, '"', length - index));
+  if (nameEnd == NULL)
+    return false;
+  fileName.assign(line + index, nameEnd - (line + index));
+  return true;
 }
 
-// Returns the start of the next quoted string
-unsigned int FileBuffer::nextOpenQuote(const string& buffer, unsigned int startPos)
+// FNV-1a hash of the text, a word at a time
+static unsigned long long hashText(const char* data, size_t length)
 {
-  unsigned int pos = startPos;
+  unsigned long long hash = 14695981039346656037ULL;
+  unsigned long long word;
+  size_t index;
+  for (index = 0; (index + sizeof(word)) <= length; index += sizeof(word)) {
+    memcpy(&word, data + index, sizeof(word));
+    hash ^= word;
+    hash *= 1099511628211ULL;
+  }
+  for (; index < length; index++) {
+    hash ^= (unsigned char)data[index];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/* Finds the line marker ending the excluded region that starts with the next
+   line, and the number of lines before it. Returns false if the region runs
+   to the end of the file */
+bool FileBuffer::findRegionEnd(size_t& end, unsigned int& lineCount) const
+{
+  const RegionFilter& filter = _headerCache->getFilter();
+  string fileName;
+  string lastFile; // Markers mostly move between a few files
+  bool lastExcluded = true;
+  size_t pos = _mapPos;
+  lineCount = 0;
+  while (pos < _mapSize) {
+    const char* line = _mapData + pos;
+    const char* lineEnd = static_cast<const char*>(memchr(line, '\n', _mapSize - pos));
+    if (lineEnd == NULL)
+      return false;
+    if (markerFileName(line, lineEnd - line, fileName)) {
+      if (fileName != lastFile) {
+        lastFile = fileName;
+        lastExcluded = filter.isExcluded(fileName);
+      }
+      if (!lastExcluded) {
+        end = pos;
+        return true;
+      }
+    }
+    lineCount++;
+    pos = (lineEnd - _mapData) + 1;
+  }
+  return false;
+}
+
+/* Called for each line marker. If it starts a region of excluded text,
+   either skips the region or marks its start in the buffer */
+void FileBuffer::startRegion(const string& fileName, unsigned int lineNo)
+{
+  bool wasExcluded = _inExcluded;
+  _inExcluded = _headerCache->getFilter().isExcluded(fileName);
+  // Only markers in the mapped text can be looked ahead of
+  if (wasExcluded || (!_inExcluded) || (!_isMapped) || (_regionEnd != 0))
+    return;
+  size_t end;
+  unsigned int lineCount;
+  if ((!findRegionEnd(end, lineCount)) || (lineCount == 0))
+    return;
+  ostringstream key;
+  key << fileName << ':' << lineNo << ':' << hex << (end - _mapPos) << ':'
+      << hashText(_mapData + _mapPos, end - _mapPos);
+  if (_headerCache->find(key.str()) != NULL) {
+    _buffer += (char)cachedRegionMark;
+    _mapPos = end;
+    _inputPosition = FilePosition(_inputPosition.getInternedFileName(),
+                                  _inputPosition.getLineNo() + lineCount);
+  }
+  else {
+    _buffer += (char)regionStartMark;
+    _regionEnd = end;
+  }
+  _buffer += key.str();
+}
+
+// Returns the start of the next quoted string in the last line read
+size_t FileBuffer::nextOpenQuote(const string& buffer, size_t startPos) const
+{
+  size_t pos = startPos;
   bool haveQuote = false;
   while ((!haveQuote) && (pos != string::npos)) {
-    pos = buffer.find_first_of('"', pos);
+    pos = nextSpecialChar('"', pos);
     if (pos != string::npos) {
       if (((pos == 0) || (buffer[pos-1] != '\'')) &&
           ((pos == (buffer.length() - 1)) || (buffer[pos+1] != '\'')))
@@ -315,10 +805,28 @@ unsigned int FileBuffer::nextOpenQuote(const string& buffer, unsigned int startP
   return pos;
 }
 
+// Returns the end of the current quoted string in the last line read
+size_t FileBuffer::nextLineCloseQuote(const string& buffer,
+                                      size_t startPos) const
+{
+  size_t pos = startPos;
+  bool haveQuote = false;
+  while ((!haveQuote) && (pos != string::npos)) {
+    pos = nextSpecialChar('"', pos);
+    if (pos != string::npos) {
+      if ((pos == 0) || (buffer[pos-1] != '\\'))
+        haveQuote = true;
+      else
+        pos++; /* move off char for next search */
+    }
+  }
+  return pos;
+}
+
 // Returns the end of the current quoted string
-unsigned int FileBuffer::nextCloseQuote(const string& buffer, unsigned int startPos)
+size_t FileBuffer::nextCloseQuote(const string& buffer, size_t startPos)
 {
-  unsigned int pos = startPos;
+  size_t pos = startPos;
   bool haveQuote = false;
   while ((!haveQuote) && (pos != string::npos)) {
     pos = buffer.find_first_of('"', pos);
@@ -334,14 +842,14 @@ unsigned int FileBuffer::nextCloseQuote(const string& buffer, unsigned int start
 
 /* If this line ends with an escaped newline, returns the position of the
    escape char, otherwise returns string::npos */
-unsigned int FileBuffer::getEscNewline(const string& buffer,
-                                       bool multiLineQuote)
+size_t FileBuffer::getEscNewline(const string& buffer,
+                                 bool multiLineQuote)
 {
   /* An escaped newline is a backslash as the last char on the line.
      A common program mistake is to put spaces after the backslash, so
      this code burns trailing spaces before looking for the backslash.
      An escaped space is not a legal symbol. */
-  unsigned int index = buffer.find_last_not_of(" \t");
+  size_t index = buffer.find_last_not_of(" \t");
   bool haveEscNewLine = false;
   if (index != string::npos) { // Not all spaces
     if (buffer[index] == '\\') {
@@ -356,7 +864,7 @@ unsigned int FileBuffer::getEscNewline(const string& buffer,
             /* Find the number of consecutive backslashes. If ite even,
                 all of them are literal backslashes and the newline
                 is NOT esacped */
-            unsigned int testPos = buffer.find_last_not_of('\\', index);
+            size_t testPos = buffer.find_last_not_of('\\', index);
             if (testPos == string::npos) // Entire string is backslashes
                 // Remember that the buffer is indexed from zero
                 haveEscNewLine = (((index + 1) % 2) == 1);
@@ -22,6 +22,49 @@
 */
 // filebuffer.h The object to access a C file
 using std::ifstream;
+using std::vector;
+
+template <class T> class SpscQueue; // Passes batches between threads, see spscqueue.h
+class HeaderCache; // Keeps what excluded header text declares, see headercache.h
+
+/* Lines read by one FileBuffer, to be returned by another on a different
+   thread. Each line holds the state of the reading buffer after the line was
+   read, and the warnings issued while reading it, so the second buffer returns
+   exactly what the first would have */
+struct LineBatch
+{
+  struct Line
+  {
+    size_t textEnd; // End of the line's text within the batch
+    size_t logEnd; // End of its warnings within the batch
+    FilePosition position;
+    bool fileEOF;
+  };
+
+  string text; // Text of every line, end to end
+  string log; // Warnings for every line, end to end
+  vector<Line> lines;
+  bool last; // True, no batches follow this one
+
+  LineBatch();
+
+  void clear();
+};
+
+inline LineBatch::LineBatch()
+    : last(false)
+{
+}
+
+inline void LineBatch::clear()
+{
+  text.clear();
+  log.clear();
+  lines.clear();
+  last = false;
+}
+
+typedef SpscQueue<LineBatch> LineQueue;
 
 /* This object does the lowest level of text processing. It reads lines from the
    file, eliminates comments, and handles preprocesor output commands. Most of this
@@ -29,20 +72,64 @@ using std::ifstream;
    as its position in the preprocessor output, so need to track both.
 
    To set EOF properly, this class actually reads the file in advance with a buffer.
-   When read, it returns the current buffer contents and then refills it */
+   When read, it returns the current buffer contents and then refills it.
+
+   Where possible the file is mapped into memory instead of being read. Most lines
+   need no processing, so the buffer then refers directly to the mapped text.
+   Only lines that contain comments, quotes, or preprocessor commands are copied.
+
+   Every line is scanned once for the chars that can change the text state,
+   giving a bit for each char of the line. The state machine walks the bits
+   instead of searching the text again for each change of state. The scan uses
+   SSE2 or AVX2 when the compiler targets them
+
+   With a header cache, a mapped file is checked for regions of excluded text
+   as line markers move into them. A region already in the cache is replaced by
+   one line holding its key, so it is never read. Otherwise the region is read
+   as usual, between lines marking its start and end */
 class FileBuffer
 {
+ public:
+  /* Chars starting the lines written for excluded regions. The rest of the
+     line is the key of the region */
+  typedef enum { cachedRegionMark = 1, regionStartMark, regionEndMark } RegionMark;
+
  private:
   typedef enum { comment, quote, preproc, other } TextState;
 
-  ifstream _file;
+  ifstream _file; // Used when the file can't be mapped into memory
+  const char* _mapData; // Mapped file contents, NULL if not mapped
+  size_t _mapSize;
+  size_t _mapPos; // Start of next line in the mapped file
+  bool _isMapped; // True, file is read from memory instead of _file
+  bool _copyFiles; // True, files are read into memory instead of mapped
+  bool _isCopy; // True, the file in memory is _fileCopy rather than a mapping
+  string _fileCopy; // Contents of the file, when it is copied
+  bool _haveFileEOF; // True, every line of the file has been read
+
+  const char* _lineData; // Last line read from the file
+  size_t _lineLength;
+  string _lineText; // Copy of the last line, when it needs processing
+  vector<unsigned long long> _specialChars; // Bit set for each char of the last line that may change state
+
   FilePosition _sourcePosition; // Position of last returned contents in original source files
   FilePosition _bufferPosition; // Position represented by current buffer contents
   FilePosition _inputPosition; // Position in preprocessor output file
-  string _buffer;
+  string _buffer; // Processed text, when it differs from the file line
+  const char* _bufferData; // Current buffer contents, either _buffer or file text
+  size_t _bufferLength;
 
   TextState _currState; // Type of text being processed
   bool _haveWrap; // Text state continued from previous line
+  ostream* _log; // Destination of warning messages
+  LineQueue* _feed; // Lines read by another buffer, NULL if reading the file
+  LineBatch _feedBatch; // Lines from the feed being returned
+  unsigned int _feedLine; // Next line to return from the batch
+  string _lineWarnings; // Warnings from reading the buffered line, for readLines()
+  bool _markerFlags; // True, line markers may end with flags, as gcc writes them
+  const HeaderCache* _headerCache; // NULL if excluded regions are not cached
+  bool _inExcluded; // True, the last line marker moved into an excluded file
+  size_t _regionEnd; // End of the excluded region being read, 0 if none
 
   // Copy constructor and equality operator. This object can't be copied
   FileBuffer(const FileBuffer& other);
@@ -51,14 +138,52 @@ class FileBuffer
   // Sets FileBuffer vars to their initial values
   void resetVars();
 
+  /* Maps the named file into memory, or copies it there if set to copy files.
+     Returns false if it can't be mapped */
+  bool mapFile(const string& fileName);
+
+  // Reads the next raw line from the file
+  void readLine();
+
+  // Marks the chars of the last line read that may change the text state
+  void scanLine();
+
+  /* Returns the position of the next char of the last line read at or after
+     the given position, which matches the given one. Only chars marked by
+     scanLine() can be found. Returns string::npos if there are none */
+  size_t nextSpecialChar(char wanted, size_t startPos) const;
+
+  // As above, but finds the next place the two chars appear together
+  size_t nextSpecialPair(char first, char second,
+                         size_t startPos) const;
+
+  // Returns true if the last line read needs no processing
+  bool havePlainLine() const;
+
   // Reads the next line to tokenize from the file.
   void fetchNextLine();
 
+  // Takes the next line to tokenize from the feed instead of the file
+  void fetchFedLine();
+
   // Handle preprocessor comamnds in the input
-  void handlePreproc(string buffer);
+  void handlePreproc(const string& buffer);
+
+  /* Called for each line marker. If it starts a region of excluded text,
+     either skips the region or marks its start in the buffer */
+  void startRegion(const string& fileName, unsigned int lineNo);
 
-   // Returns the start of the next quoted string
-  unsigned int nextOpenQuote(const string& buffer, unsigned int startPos);
+  /* Finds the line marker ending the excluded region that starts with the next
+     line, and the number of lines before it. Returns false if the region runs
+     to the end of the file */
+  bool findRegionEnd(size_t& end, unsigned int& lineCount) const;
+
+   // Returns the start of the next quoted string in the last line read
+  size_t nextOpenQuote(const string& buffer, size_t startPos) const;
+
+  // Returns the end of the current quoted string in the last line read
+  size_t nextLineCloseQuote(const string& buffer,
+                            size_t startPos) const;
 
 public:
   FileBuffer();
@@ -67,14 +192,40 @@ public:
   ~FileBuffer();
 
   // Opens the given file, which must be in the current directory.
-  void open(string fileName);
+  void open(const string& fileName);
+
+  /* Opens the buffer on lines read from the named file by another buffer,
+     usually on another thread */
+  void open(const string& fileName, LineQueue& lines);
+
+  /* Moves lines from the file into the batch for another buffer to return,
+     up to the given count, along with the warnings issued reading them */
+  void readLines(LineBatch& batch, unsigned int maxLines);
 
   // Closes the filebuffer
   void close();
 
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
+  /* Sets whether line markers may be followed by flags. Otherwise they are
+     reported as unexpected preprocessor commands */
+  void setMarkerFlags(bool markerFlags);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(const HeaderCache* headerCache);
+
+  /* Sets whether files are copied into memory instead of mapped. A mapped file
+     that shrinks while being read crashes the program, so copy files that may
+     be edited while they are indexed */
+  void setCopyFiles(bool copyFiles);
+
   // Reads a processed line from the file
   FileBuffer& operator>>(string &result);
 
+  // Reads a processed line from the file, adding it to the end of the result
+  void appendLine(string& result);
+
   // Returns true if at EOF
   bool haveEOF() const;
 
@@ -82,8 +233,8 @@ public:
   const FilePosition& getFilePosition() const;
 
   // Returns the end of the current quoted string
-  static unsigned int nextCloseQuote(const string& buffer,
-                                     unsigned int startPos);
+  static size_t nextCloseQuote(const string& buffer,
+                               size_t startPos);
 
   // Returns true if the final char in the string is an escaped newline char
   static bool hasEscNewline(const string& buffer,
@@ -91,30 +242,61 @@ public:
 
   /* If this line ends with an escaped newline, returns the position of the
      escape char, otherwise returns string::npos */
-  static unsigned int getEscNewline(const string& buffer,
-                                    bool multiLineQuote);
+  static size_t getEscNewline(const string& buffer,
+                              bool multiLineQuote);
 
   // Burns all spaces after the given position, and returns the position afterwards
-  static unsigned int burnSpaces(const string& buffer,
-                                 unsigned int startPos = 0);
+  static size_t burnSpaces(const string& buffer,
+                           size_t startPos = 0);
 };
 
 // Set a filebuffer to its initial state
 inline void FileBuffer::resetVars()
 {
+  _mapData = NULL;
+  _mapSize = 0;
+  _mapPos = 0;
+  _isMapped = false;
+  _isCopy = false;
+  _haveFileEOF = true;
+  _lineData = NULL;
+  _lineLength = 0;
+  _bufferData = NULL;
+  _bufferLength = 0;
   _sourcePosition = FilePosition("", 0);
   _inputPosition = _sourcePosition;
   _bufferPosition = _sourcePosition;
   _currState = other;
   _haveWrap = false;
+  _feed = NULL;
+  _feedLine = 0;
+  _lineWarnings.clear();
+  _inExcluded = false;
+  _regionEnd = 0;
+}
+
+// Sets where warning messages are written
+inline void FileBuffer::setLog(ostream& log)
+{
+  _log = &log;
 }
 
-// Closes the filebuffer
-inline void FileBuffer::close()
+// Sets whether line markers may be followed by flags
+inline void FileBuffer::setMarkerFlags(bool markerFlags)
 {
-  if (_file.is_open())
-    _file.close();
-  resetVars();
+  _markerFlags = markerFlags;
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void FileBuffer::setHeaderCache(const HeaderCache* headerCache)
+{
+  _headerCache = headerCache;
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void FileBuffer::setCopyFiles(bool copyFiles)
+{
+  _copyFiles = copyFiles;
 }
 
 // Returns true if at EOF
@@ -122,7 +304,7 @@ inline bool FileBuffer::haveEOF() const
 {
     /* At end of file when last line is read AND the buffer
         has been returned, signaled by it being empty */
-    return (_file.eof() && _buffer.empty());
+    return (_haveFileEOF && (_bufferLength == 0));
 }
 
 // Reads the next line to tokenize from the file.
@@ -133,12 +315,21 @@ inline FileBuffer& FileBuffer::operator>> (string& result)
         anc cache the result for the next call. This will change
         the file position data, so need to cache that as well so
         it will match the location of the returned data */
-    result = _buffer;
+    result.assign(_bufferData, _bufferLength);
     _sourcePosition = _bufferPosition;
     fetchNextLine();
     return *this;
 }
 
+// Reads a processed line from the file, adding it to the end of the result
+inline void FileBuffer::appendLine(string& result)
+{
+    // See above for why this is a look-ahead
+    result.append(_bufferData, _bufferLength);
+    _sourcePosition = _bufferPosition;
+    fetchNextLine();
+}
+
 // Return the position data for the most recently read line of the source
 inline const FilePosition& FileBuffer::getFilePosition() const
 {
@@ -146,8 +337,8 @@ inline const FilePosition& FileBuffer::getFilePosition() const
 }
 
 // Burns all spaces after the given position, and returns the position afterwards
-inline unsigned int FileBuffer::burnSpaces(const string& buffer,
-                                           unsigned int startPos)
+inline size_t FileBuffer::burnSpaces(const string& buffer,
+                                     size_t startPos)
 {
     // NOTE: \t is the tab character
     return buffer.find_first_not_of(" \t", startPos);
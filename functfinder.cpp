@@ -23,19 +23,26 @@
 // Functfinder.cpp Support routines for creating function descriptions
 
 #include <string>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <utility>
 #include <list>
 #include <algorithm>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <functional>
 #include"basetypes.h"
+#include"indexstats.h"
 #include"errors.h"
 #include"filebuffer.h"
 #include"tokenizer.h"
 #include"namespace.h"
 #include"parser.h"
+#include"arena.h"
 #include"functfinder.h"
 
 
@@ -43,32 +50,30 @@ using std::string;
 using std::fstream;
 using std::list;
 using std::vector;
+using std::sort;
 
 FunctHold::FunctHold()
+    : _holdData(0, InternedStringHash(), equal_to<InternedString>(),
+                HoldAllocator(&_holdArena))
 {
     reset();
 }
 
-// Moves data from the hold map to function data cache
-void FunctHold::moveHoldToCache(HoldMap::iterator first, HoldMap::iterator last,
-                                Token::ScopeType wantScope)
+// Moves the bucket from the hold map to the release list
+void FunctHold::moveHoldToCache(HoldMap::iterator bucket, Token::ScopeType wantScope)
 {
-    if (first != last) { // Have tokens to release
-      // Convert to function data and add to cache
-      HoldMap::iterator tokenIndex;
-      for (tokenIndex = first; tokenIndex != last; tokenIndex++) {
-        // Set scope
-        Token temp(tokenIndex->first);
-        temp.setScope(wantScope);
-        _releaseData.push_back(FunctionData(temp, tokenIndex->second));
-      } // Data conversion and cache
-      _holdData.erase(first, last); // Remove it from the hold map
-    } // Have function calls to process
+    STATS_TIMER(holdStage);
+    // Nothing is held while releasing, so the list is empty and can just be swapped
+    _releaseData.swap(bucket->second);
+    _releaseScope = wantScope;
+    _holdCount -= _releaseData.size();
+    _holdData.erase(bucket);
 }
 
 // Holds a token if necessary
-bool FunctHold::holdIfNeeded(const Token& testToken, const string& callFunct)
+bool FunctHold::holdIfNeeded(const Token& testToken, const InternedString& callFunct)
 {
+  STATS_TIMER(holdStage);
   // Only hold if scope for function call not known yet
   if ((testToken.getType() != Token::functcall) ||
       (testToken.getScope() != Token::noscope))
@@ -79,7 +84,10 @@ bool FunctHold::holdIfNeeded(const Token& testToken, const string& callFunct)
   else if (doingRelease())
     throw DouFuncRelException();
   else {
-    _holdData.insert(make_pair(testToken, callFunct));
+    _holdData[testToken.getInternedLexeme()].push_back(HoldBucket::value_type(testToken, callFunct));
+    _holdCount++;
+    STATS_COUNT(holds, 1);
+    STATS_PEAK(peakHolds, _holdCount);
     return true;
   }
 }
@@ -90,9 +98,23 @@ FunctionData FunctHold::procEOF()
   /* Return all remaining function calls with global scope. If the call is
      still held at this point, the file does not have a declaration for the
      function, so it must be declared somewhere else */
-  if (!_holdData.empty())
-     // Convert the entire map to function data
-     moveHoldToCache(_holdData.begin(), _holdData.end(), Token::globalscope);
+  if (!_holdData.empty()) {
+    /* Release them all at once, in order by name and then in the order found,
+       so the calls come out the same each run */
+    vector<InternedString> names;
+    vector<InternedString>::const_iterator name;
+    HoldMap::iterator bucket;
+    for (bucket = _holdData.begin(); bucket != _holdData.end(); bucket++)
+      names.push_back(bucket->first);
+    sort(names.begin(), names.end());
+    for (name = names.begin(); name != names.end(); name++) {
+      HoldBucket& calls = _holdData.find(*name)->second;
+      _releaseData.insert(_releaseData.end(), calls.begin(), calls.end());
+    }
+    _releaseScope = Token::globalscope;
+    _holdData.clear();
+    _holdCount = 0;
+  }
 
   if (empty())
     return FunctionData(Token("", FilePosition("", 0), Token::notoken),
@@ -122,7 +144,7 @@ FunctionData FunctFinder::nextFunction()
         if (functToken.getType() == Token::functdecl) {
             // Declaration. Now processing an new function
             _functCallsNoScope.releaseHold(functToken);
-            _currFunction = functToken.getLexeme();
+            _currFunction = functToken.getInternedLexeme();
             haveFunct = true;
         }
         else if (!_functCallsNoScope.holdIfNeeded(functToken, _currFunction)) {
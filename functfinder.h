@@ -21,30 +21,34 @@
     a link to the code depository)
 */
 // Functfinder.h Description of object to hold descriptions until they are complete
-using std::multimap;
+using std::unordered_map;
 using std::pair;
-using std::make_pair;
+using std::equal_to;
 
 class FunctHold {
 
 /* This class holds data for function calls with unknown scope. They are released
-    when the scope is known, which is set per function. This natually leads to a
-    multimap indexed by token to hold the data. When released, the data for the
-    matching tokens is converted to FunctionData and cached. Callers expect it to
-    be returned one at a time, and using a cache takes up the same amount of space
-    as leaving the data in the map, and is cleaner to implement. The end of token
-    processing triggers a release of the remaining data */
+    when the scope is known, which is set per function. The calls are held in a
+    bucket per function name, found through a hash table. When released, the
+    whole bucket is handed to the release list at once, and its calls are
+    converted to FunctionData one at a time as callers ask for them. The end of
+    token processing triggers a release of the remaining data */
 
 private:
-  typedef multimap<Token, string> HoldMap;
+  typedef vector<pair<Token, InternedString> > HoldBucket; // Each call and its caller
+  typedef ArenaAllocator<pair<const InternedString, HoldBucket> > HoldAllocator;
+  typedef unordered_map<InternedString, HoldBucket, InternedStringHash,
+                        equal_to<InternedString>, HoldAllocator> HoldMap;
 
-  HoldMap _holdData;
+  Arena _holdArena; // Memory for the hold map, released when a new file starts
+  HoldMap _holdData; // Held calls, by function name
+  unsigned long _holdCount; // Calls in the hold map
 
-  vector<FunctionData> _releaseData;
+  HoldBucket _releaseData; // Calls being released, last one first
+  Token::ScopeType _releaseScope; // Scope the calls being released get
 
-  // Moves data from the hold map to function data cache
-  void moveHoldToCache(HoldMap::iterator begin, HoldMap::iterator end,
-                       Token::ScopeType wantScope);
+  // Moves the bucket from the hold map to the release list
+  void moveHoldToCache(HoldMap::iterator bucket, Token::ScopeType wantScope);
 
   // This object is part of an object based on a file, so it can't be copied
   FunctHold(const FunctHold& other);
@@ -70,7 +74,7 @@ public:
   bool empty();
 
   // Holds a token if necessary
-  bool holdIfNeeded(const Token& testToken, const string& callFunct);
+  bool holdIfNeeded(const Token& testToken, const InternedString& callFunct);
 
   // Special processing for end of file. This releases all holds
   FunctionData procEOF();
@@ -79,14 +83,21 @@ public:
 // Initializes the object
 inline void FunctHold::reset()
 {
-  _holdData.clear();
+  /* Clearing keeps the table of buckets, which is in the arena, so swap in an
+     empty map instead. Must come before the arena reset */
+  HoldMap(0, InternedStringHash(), equal_to<InternedString>(),
+          HoldAllocator(&_holdArena)).swap(_holdData);
+  _holdArena.reset();
+  _holdCount = 0;
   _releaseData.clear();
 }
 
 // Returns function description of next token to release from hold
 inline FunctionData FunctHold::nextRelease()
 {
-    FunctionData newData(_releaseData.back());
+    Token call(_releaseData.back().first);
+    call.setScope(_releaseScope);
+    FunctionData newData(call, _releaseData.back().second);
     _releaseData.pop_back();
     return newData;
 }
@@ -105,8 +116,9 @@ inline bool FunctHold::empty()
 inline void FunctHold::releaseHold(const Token& declToken)
 {
   if (declToken.getType() == Token::functdecl) {
-    pair<HoldMap::iterator, HoldMap::iterator> tokens = _holdData.equal_range(declToken);
-    moveHoldToCache(tokens.first, tokens.second, declToken.getScope());
+    HoldMap::iterator bucket = _holdData.find(declToken.getInternedLexeme());
+    if (bucket != _holdData.end())
+      moveHoldToCache(bucket, declToken.getScope());
   } // Token is actually a function declaration
 }
 
@@ -114,7 +126,7 @@ inline void FunctHold::releaseHold(const Token& declToken)
 class FunctFinder {
  private:
   Parser _functBuffer; // Source of data
-  string _currFunction; // Current function declaration being processed
+  InternedString _currFunction; // Current function declaration being processed
   FunctHold _functCallsNoScope; // Object to hold calls with incompelete scope
   // This object is based on a file, so it can't be copied
   FunctFinder(const FunctFinder& other);
@@ -129,6 +141,24 @@ class FunctFinder {
   // Starts the function finder on the give file
   void start(const string& fileName);
 
+  // Reports problems still pending from the current file
+  void finish();
+
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
+  // Sets whether files are read and lexed on separate threads
+  void setPipelined(bool pipelined);
+
+  // Sets the filter deciding which source files are indexed, or NULL for all of them
+  void setFilter(const RegionFilter* filter);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(HeaderCache* headerCache);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
+
   // Returns true if all functions have been processed
   bool haveEOF();
 
@@ -150,6 +180,42 @@ inline void FunctFinder::start(const string& fileName)
     _functBuffer.start(fileName);
 }
 
+// Reports problems still pending from the current file
+inline void FunctFinder::finish()
+{
+    _functBuffer.finish();
+}
+
+// Sets where warning messages are written
+inline void FunctFinder::setLog(ostream& log)
+{
+    _functBuffer.setLog(log);
+}
+
+// Sets whether files are read and lexed on separate threads
+inline void FunctFinder::setPipelined(bool pipelined)
+{
+    _functBuffer.setPipelined(pipelined);
+}
+
+// Sets the filter deciding which source files are indexed, or NULL for all of them
+inline void FunctFinder::setFilter(const RegionFilter* filter)
+{
+    _functBuffer.setFilter(filter);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void FunctFinder::setHeaderCache(HeaderCache* headerCache)
+{
+    _functBuffer.setHeaderCache(headerCache);
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void FunctFinder::setCopyFiles(bool copyFiles)
+{
+    _functBuffer.setCopyFiles(copyFiles);
+}
+
 inline bool FunctFinder::haveEOF()
 {
     // At end when source file processed and hold list is empty
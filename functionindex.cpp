@@ -0,0 +1,179 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functionindex.cpp Answers questions about a group of function descriptions
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include "basetypes.h"
+#include "functionindex.h"
+
+using std::string;
+using std::vector;
+using std::sort;
+using std::stable_sort;
+
+FunctionIndex::FunctionIndex()
+{
+}
+
+const InternedString& FunctionIndex::nameKey(const FunctionData& data)
+{
+  return data.getName();
+}
+
+const InternedString& FunctionIndex::callerKey(const FunctionData& data)
+{
+  return data.getCaller();
+}
+
+const InternedString& FunctionIndex::fileKey(const FunctionData& data)
+{
+  return data.getFilePosition().getInternedFileName();
+}
+
+// Orders functions by caller, keeping the existing order otherwise
+bool FunctionIndex::lessCaller(const FunctionData* first, const FunctionData* second)
+{
+  return (first->getCaller() < second->getCaller());
+}
+
+bool FunctionIndex::lessFile(const FunctionData* first, const FunctionData* second)
+{
+  return (fileKey(*first) < fileKey(*second));
+}
+
+// Records the group for each name in a list, which must be grouped by name
+void FunctionIndex::findSpans(const FunctionList& list, KeyFunction key, SpanMap& spans)
+{
+  unsigned int start = 0;
+  unsigned int index;
+  spans.clear();
+  for (index = 1; index <= list.size(); index++)
+    if ((index == list.size()) || (key(*list[index]) != key(*list[start]))) {
+      spans[key(*list[start])] = Span(start, index);
+      start = index;
+    }
+}
+
+// Returns the range in the list for the name, an empty range if none
+FunctionIndex::Range FunctionIndex::findRange(const FunctionList& list,
+                                              const SpanMap& spans,
+                                              const InternedString& name)
+{
+  SpanMap::const_iterator span = spans.find(name);
+  if (span == spans.end())
+    return Range(list.end(), list.end());
+  else
+    return Range(list.begin() + span->second.first, list.begin() + span->second.second);
+}
+
+// Clears the lists before functions are added
+void FunctionIndex::clearLists()
+{
+  _declarations.clear();
+  _calls.clear();
+  _byCaller.clear();
+  _byFile.clear();
+  _callees.clear();
+}
+
+// Adds a function to the lists. Functions must be added in output order
+void FunctionIndex::addFunction(const FunctionData* function)
+{
+  if (function->isDeclaration())
+    _declarations.push_back(function);
+  else
+    _calls.push_back(function);
+  _byFile.push_back(function);
+}
+
+// Groups the lists, after every function is added
+void FunctionIndex::finishLists()
+{
+  unsigned int index;
+
+  // Sorted by name already, so these lists are grouped by name
+  findSpans(_declarations, nameKey, _declarationSpans);
+  findSpans(_calls, nameKey, _callSpans);
+
+  /* Stable sorts keep the output order within each group. For calls, that
+     leaves the functions called grouped by name */
+  _byCaller = _calls;
+  stable_sort(_byCaller.begin(), _byCaller.end(), lessCaller);
+  findSpans(_byCaller, callerKey, _callerSpans);
+  stable_sort(_byFile.begin(), _byFile.end(), lessFile);
+  findSpans(_byFile, fileKey, _fileSpans);
+
+  // Adjacency lists list each function called only once
+  _calleeSpans.clear();
+  unsigned int start = 0;
+  for (index = 0; index < _byCaller.size(); index++) {
+    const FunctionData* function = _byCaller[index];
+    if ((index > 0) && (function->getCaller() != _byCaller[index - 1]->getCaller()))
+      start = _callees.size(); // New caller
+    if ((_callees.size() == start) || (_callees.back() != function->getName()))
+      _callees.push_back(function->getName());
+    _calleeSpans[function->getCaller()] = Span(start, _callees.size());
+  }
+}
+
+// Builds the index from the given functions, replacing anything already there
+void FunctionIndex::build(const vector<FunctionData>& functions)
+{
+  unsigned int index;
+
+  _functions = functions;
+  sort(_functions.begin(), _functions.end());
+  clearLists();
+  for (index = 0; index < _functions.size(); index++)
+    addFunction(&_functions[index]);
+  finishLists();
+}
+
+/* Builds the index from functions already in output order, replacing
+   anything already there. The index refers to the functions in the set */
+void FunctionIndex::build(const multiset<FunctionData>& functions)
+{
+  multiset<FunctionData>::const_iterator index;
+
+  vector<FunctionData>().swap(_functions);
+  clearLists();
+  for (index = functions.begin(); index != functions.end(); index++)
+    addFunction(&*index);
+  finishLists();
+}
+
+// Returns the names of the functions a function calls, each only once, in order
+FunctionIndex::NameRange FunctionIndex::findCallees(const InternedString& caller) const
+{
+  SpanMap::const_iterator span = _calleeSpans.find(caller);
+  if (span == _calleeSpans.end())
+    return NameRange(_callees.end(), _callees.end());
+  else
+    return NameRange(_callees.begin() + span->second.first,
+                     _callees.begin() + span->second.second);
+}
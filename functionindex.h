@@ -0,0 +1,144 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functionindex.h Answers questions about a group of function descriptions
+using std::unordered_map;
+using std::pair;
+using std::multiset;
+
+/* This object indexes a group of function descriptions, so questions about
+   them can be answered without searching all of them. Functions are kept in
+   the same order as the output table. Separate lists hold declarations, calls,
+   calls grouped by the function they are made from, and everything grouped by
+   file. Each list is divided into groups by name, and a hash table gives the
+   group for each name, so lookups take constant time. Names are interned, so
+   hashing them only hashes an address.
+     Lookups return a range of pointers into the index. They remain valid until
+   the index is built again. An index built from a sorted set points into the
+   set instead, so nothing is copied or sorted, and the set must not change
+   until the index is built again */
+class FunctionIndex
+{
+ public:
+  typedef vector<const FunctionData*> FunctionList;
+  typedef pair<FunctionList::const_iterator, FunctionList::const_iterator> Range;
+  typedef vector<InternedString> NameList;
+  typedef pair<NameList::const_iterator, NameList::const_iterator> NameRange;
+
+ private:
+  // Location of a group within a list, as the first and one past the last index
+  typedef pair<unsigned int, unsigned int> Span;
+  typedef unordered_map<InternedString, Span, InternedStringHash> SpanMap;
+  // Returns the name a list is grouped by
+  typedef const InternedString& (*KeyFunction)(const FunctionData& data);
+
+  vector<FunctionData> _functions; // In output order, if not built from a set
+  FunctionList _declarations;
+  FunctionList _calls; // Calls and refrences
+  FunctionList _byCaller; // Calls grouped by the function making them
+  FunctionList _byFile;
+  NameList _callees; // Functions called from each function, grouped by caller
+  SpanMap _declarationSpans;
+  SpanMap _callSpans;
+  SpanMap _callerSpans;
+  SpanMap _calleeSpans;
+  SpanMap _fileSpans;
+
+  // Records the group for each name in a list, which must be grouped by name
+  static void findSpans(const FunctionList& list, KeyFunction key, SpanMap& spans);
+
+  // Returns the range in the list for the name, an empty range if none
+  static Range findRange(const FunctionList& list, const SpanMap& spans,
+                         const InternedString& name);
+
+  static const InternedString& nameKey(const FunctionData& data);
+  static const InternedString& callerKey(const FunctionData& data);
+  static const InternedString& fileKey(const FunctionData& data);
+
+  // Orders functions by caller, keeping the existing order otherwise
+  static bool lessCaller(const FunctionData* first, const FunctionData* second);
+  static bool lessFile(const FunctionData* first, const FunctionData* second);
+
+  // Adds a function to the lists. Functions must be added in output order
+  void addFunction(const FunctionData* function);
+
+  // Clears the lists before functions are added
+  void clearLists();
+
+  // Groups the lists, after every function is added
+  void finishLists();
+
+  // Lookups point into the object, so it can't be copied
+  FunctionIndex(const FunctionIndex& other);
+  FunctionIndex& operator=(const FunctionIndex& other);
+
+ public:
+  FunctionIndex();
+
+  // This object uses the default destructor
+
+  // Builds the index from the given functions, replacing anything already there
+  void build(const vector<FunctionData>& functions);
+
+  /* Builds the index from functions already in output order, replacing
+     anything already there. The index refers to the functions in the set */
+  void build(const multiset<FunctionData>& functions);
+
+  // Returns the declarations of a function
+  Range findDeclarations(const InternedString& name) const;
+
+  // Returns the calls and refrences to a function
+  Range findCalls(const InternedString& name) const;
+
+  // Returns the calls and refrences made from within a function
+  Range findCallsFrom(const InternedString& caller) const;
+
+  // Returns the names of the functions a function calls, each only once, in order
+  NameRange findCallees(const InternedString& caller) const;
+
+  // Returns everything found in a source file
+  Range findInFile(const InternedString& fileName) const;
+};
+
+// Returns the declarations of a function
+inline FunctionIndex::Range FunctionIndex::findDeclarations(const InternedString& name) const
+{
+  return findRange(_declarations, _declarationSpans, name);
+}
+
+// Returns the calls and refrences to a function
+inline FunctionIndex::Range FunctionIndex::findCalls(const InternedString& name) const
+{
+  return findRange(_calls, _callSpans, name);
+}
+
+// Returns the calls and refrences made from within a function
+inline FunctionIndex::Range FunctionIndex::findCallsFrom(const InternedString& caller) const
+{
+  return findRange(_byCaller, _callerSpans, caller);
+}
+
+// Returns everything found in a source file
+inline FunctionIndex::Range FunctionIndex::findInFile(const InternedString& fileName) const
+{
+  return findRange(_byFile, _fileSpans, fileName);
+}
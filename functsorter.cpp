@@ -0,0 +1,396 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functsorter.cpp Sorts function descriptions with a bounded amount of memory
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <queue>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <cstdio>
+#include "basetypes.h"
+#include "functsorter.h"
+
+using std::string;
+using std::vector;
+using std::sort;
+using std::inplace_merge;
+using std::unordered_map;
+using std::thread;
+using std::FILE;
+using std::tmpfile;
+using std::fclose;
+using std::fwrite;
+using std::fread;
+using std::rewind;
+using std::fflush;
+using std::ferror;
+
+FunctionSorter::MergeEntry::MergeEntry(const FunctionData& data, unsigned int run)
+    : _data(data), _run(run)
+{
+}
+
+// Priority queues return the largest entry first, so this is reversed
+bool FunctionSorter::MergeEntry::operator<(const MergeEntry& other) const
+{
+  if (other._data < _data)
+    return true;
+  else if (_data < other._data)
+    return false;
+  else
+    // Identical functions, take from the earlier run first
+    return (_run > other._run);
+}
+
+/* Constructor. Sets the max functions held in memory, zero for no limit,
+   and the number of threads to use for sorting */
+FunctionSorter::FunctionSorter(unsigned long maxInMemory, unsigned int threadCount)
+    : _maxInMemory(maxInMemory), _threadCount(threadCount), _count(0),
+      _nextFunction(0), _spillFailed(false), _readFailed(false)
+{
+  if (_threadCount < 1)
+    _threadCount = 1;
+}
+
+// Destructor. Deletes any temporary files
+FunctionSorter::~FunctionSorter()
+{
+  unsigned int index;
+  // Files from tmpfile() are deleted when closed
+  for (index = 0; index < _runs.size(); index++)
+    if (_runs[index] != NULL)
+      fclose(_runs[index]);
+}
+
+// Writes a number of the given size in bytes, low byte first
+static void appendNumber(string& buffer, unsigned long value, unsigned int size)
+{
+  unsigned int index;
+  for (index = 0; index < size; index++) {
+    buffer += (char)(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+static void appendText(string& buffer, const string& text)
+{
+  appendNumber(buffer, text.length(), 4);
+  buffer += text;
+}
+
+static bool readNumber(FILE* run, unsigned long& value, unsigned int size)
+{
+  unsigned char bytes[4];
+  unsigned int index;
+  if (fread(bytes, 1, size, run) != size)
+    return false;
+  value = 0;
+  for (index = 0; index < size; index++)
+    value |= ((unsigned long)bytes[index]) << (8 * index);
+  return true;
+}
+
+static bool readText(FILE* run, string& text)
+{
+  unsigned long length;
+  if (!readNumber(run, length, 4))
+    return false;
+  text.resize(length);
+  return ((length == 0) || (fread(&text[0], 1, length, run) == length));
+}
+
+// Returns false if the function can't be written
+bool FunctionSorter::writeFunction(FILE* run, const FunctionData& data)
+{
+  string buffer;
+  appendText(buffer, data.getName().str());
+  appendText(buffer, data.getCaller().str());
+  appendText(buffer, data.getFilePosition().getFileName());
+  appendNumber(buffer, (unsigned long)data.getFilePosition().getLineNo(), 4);
+  appendNumber(buffer, (data.isDeclaration() ? 1 : 0) | (data.isRefrence() ? 2 : 0) |
+                       (data.isFileScope() ? 4 : 0), 1);
+  return (fwrite(buffer.data(), 1, buffer.length(), run) == buffer.length());
+}
+
+/* Recreates the next function from the run. Returns false at the end of the
+   run, or if it can't be read */
+bool FunctionSorter::readFunction(FILE* run, FunctionData& result)
+{
+  string name;
+  string caller;
+  string fileName;
+  unsigned long lineNo;
+  unsigned long flags;
+  if ((!readText(run, name)) || (!readText(run, caller)) ||
+      (!readText(run, fileName)) || (!readNumber(run, lineNo, 4)) ||
+      (!readNumber(run, flags, 1))) {
+    if (ferror(run))
+      _readFailed = true;
+    return false;
+  }
+  result = FunctionData(name, FilePosition(fileName, (int)lineNo),
+                        ((flags & 1) != 0), caller, ((flags & 2) != 0),
+                        ((flags & 4) != 0));
+  return true;
+}
+
+// Sorts one piece of the keys, on its own thread
+void FunctionSorter::sortPiece(SortKeyIter first, SortKeyIter last)
+{
+  sort(first, last);
+}
+
+// Merges two adjacent sorted pieces of the keys, on its own thread
+void FunctionSorter::mergePieces(SortKeyIter first, SortKeyIter middle, SortKeyIter last)
+{
+  inplace_merge(first, middle, last);
+}
+
+// Sorts the keys, using the given number of threads
+void FunctionSorter::sortKeys(SortKeyIter first, SortKeyIter last, unsigned int threadCount)
+{
+  size_t count = last - first;
+  if (threadCount > (count / _MinThreadSort))
+    threadCount = count / _MinThreadSort;
+  if (threadCount <= 1) {
+    sort(first, last);
+    return;
+  }
+
+  // Sort a piece on each thread
+  vector<SortKeyIter> bounds; // Start of each piece, then the end of the last one
+  vector<thread> workers;
+  unsigned int index;
+  for (index = 0; index <= threadCount; index++)
+    bounds.push_back(first + ((count * index) / threadCount));
+  for (index = 0; index < threadCount; index++)
+    workers.push_back(thread(sortPiece, bounds[index], bounds[index + 1]));
+  for (index = 0; index < workers.size(); index++)
+    workers[index].join();
+
+  // Merge pairs of pieces at once until only one remains
+  while (bounds.size() > 2) {
+    vector<SortKeyIter> mergedBounds;
+    workers.clear();
+    for (index = 0; (index + 2) < bounds.size(); index += 2) {
+      workers.push_back(thread(mergePieces, bounds[index], bounds[index + 1],
+                               bounds[index + 2]));
+      mergedBounds.push_back(bounds[index]);
+    }
+    if ((index + 1) < bounds.size()) // Odd piece left over
+      mergedBounds.push_back(bounds[index]);
+    mergedBounds.push_back(bounds.back());
+    for (index = 0; index < workers.size(); index++)
+      workers[index].join();
+    bounds.swap(mergedBounds);
+  }
+}
+
+// Sorts the functions in memory
+void FunctionSorter::sortFunctions()
+{
+  typedef unordered_map<InternedString, unsigned long long, InternedStringHash> RankMap;
+  RankMap ranks;
+  vector<InternedString> strings;
+  vector<FunctionData>::const_iterator function;
+  unsigned int index;
+
+  // Rank every distinct string by its text
+  for (function = _functions.begin(); function != _functions.end(); function++) {
+    const InternedString* fields[3] = { &function->getName(), &function->getCaller(),
+                                        &function->getFilePosition().getInternedFileName() };
+    for (index = 0; index < 3; index++)
+      if (ranks.insert(RankMap::value_type(*fields[index], 0)).second)
+        strings.push_back(*fields[index]);
+  }
+  sort(strings.begin(), strings.end());
+  for (index = 0; index < strings.size(); index++)
+    ranks[strings[index]] = index;
+
+  /* Build the keys. Ranks take 31 bits at most, so each field fits in its
+     place. See FunctionData::operator< for the order */
+  vector<SortKey> keys(_functions.size());
+  for (index = 0; index < _functions.size(); index++) {
+    const FunctionData& data = _functions[index];
+    unsigned long long name = ranks[data.getName()];
+    unsigned long long file = ranks[data.getFilePosition().getInternedFileName()];
+    unsigned long long caller = ranks[data.getCaller()];
+    // Flip the sign bit so negative line numbers sort first
+    unsigned long long lineNo = ((unsigned int)data.getFilePosition().getLineNo()) ^ 0x80000000U;
+    SortKey& key = keys[index];
+    // File scope functions sort first, then by file. The file is ignored otherwise
+    key.major = (name << 32) | (data.isFileScope() ? file : 0x80000000ULL);
+    key.middle = ((data.isDeclaration() ? 0ULL : 1ULL) << 63) | (file << 32) | lineNo;
+    key.minor = (caller << 1) | (data.isRefrence() ? 1 : 0);
+    key.index = index;
+  }
+  sortKeys(keys.begin(), keys.end(), _threadCount);
+
+  vector<FunctionData> sorted;
+  sorted.reserve(_functions.size());
+  for (index = 0; index < keys.size(); index++)
+    sorted.push_back(std::move(_functions[keys[index].index]));
+  _functions.swap(sorted);
+}
+
+// Sorts functions in memory and writes them as a new run
+void FunctionSorter::writeRun()
+{
+  FILE* run = tmpfile();
+  if (run == NULL) {
+    // Runs already written must still be merged, so bring them back too
+    stopSpilling();
+    return;
+  }
+  sortFunctions();
+  vector<FunctionData>::const_iterator index;
+  bool written = true;
+  for (index = _functions.begin(); written && (index != _functions.end()); index++)
+    written = writeFunction(run, *index);
+  // Buffered data may only fail to write once flushed
+  if ((!written) || (fflush(run) != 0)) {
+    fclose(run);
+    stopSpilling();
+    return;
+  }
+  _runs.push_back(run);
+  // Actually release the memory, not just the contents
+  vector<FunctionData>().swap(_functions);
+
+  // Keep the number of open runs down, so output never needs too many at once
+  if (_runs.size() >= (2 * _MaxMergeRuns))
+    mergeRuns(0, _MaxMergeRuns);
+}
+
+// Merges the runs in the given range into a new run, replacing them
+void FunctionSorter::mergeRuns(unsigned int first, unsigned int last)
+{
+  FILE* result = tmpfile();
+  if (result == NULL) {
+    // Leaving the runs as they are would only let them pile up
+    stopSpilling();
+    return;
+  }
+  MergeQueue merge;
+  FunctionData data(InternedString(), FilePosition(InternedString(), 0), false,
+                    InternedString(), false, false);
+  unsigned int index;
+  for (index = first; index < last; index++) {
+    rewind(_runs[index]);
+    if (readFunction(_runs[index], data))
+      merge.push(MergeEntry(data, index));
+  }
+  bool written = true;
+  while (written && (!merge.empty())) {
+    MergeEntry next = merge.top();
+    merge.pop();
+    written = writeFunction(result, next._data);
+    if (readFunction(_runs[next._run], data))
+      merge.push(MergeEntry(data, next._run));
+  }
+  if ((!written) || (fflush(result) != 0)) {
+    // The runs being merged are still whole, so read them back instead
+    fclose(result);
+    stopSpilling();
+    return;
+  }
+  for (index = first; index < last; index++)
+    fclose(_runs[index]);
+  /* Runs are merged oldest first, and the merge is stable, so keep the
+     result in the place of the runs it replaces */
+  _runs.erase(_runs.begin() + first + 1, _runs.begin() + last);
+  _runs[first] = result;
+}
+
+/* Reads the runs back into memory and stops writing them, after a write fails
+   or a temporary file can't be created */
+void FunctionSorter::stopSpilling()
+{
+  FunctionData data(InternedString(), FilePosition(InternedString(), 0), false,
+                    InternedString(), false, false);
+  unsigned int index;
+  _spillFailed = true;
+  _maxInMemory = 0;
+  for (index = 0; index < _runs.size(); index++) {
+    rewind(_runs[index]);
+    while (readFunction(_runs[index], data))
+      _functions.push_back(data);
+    fclose(_runs[index]);
+  }
+  _runs.clear();
+}
+
+// Prepares to output the functions. No more can be added afterward
+void FunctionSorter::startOutput()
+{
+  _nextFunction = 0;
+  if (_runs.empty())
+    // Everything fit in memory
+    sortFunctions();
+  else {
+    if (!_functions.empty())
+      writeRun();
+    while (_runs.size() > _MaxMergeRuns)
+      mergeRuns(0, _MaxMergeRuns);
+    if (_runs.empty()) {
+      // A run failed to write, so everything is back in memory
+      sortFunctions();
+      return;
+    }
+
+    FunctionData data(InternedString(), FilePosition(InternedString(), 0), false,
+                      InternedString(), false, false);
+    unsigned int index;
+    for (index = 0; index < _runs.size(); index++) {
+      rewind(_runs[index]);
+      if (readFunction(_runs[index], data))
+        _merge.push(MergeEntry(data, index));
+    }
+  }
+}
+
+// Returns the next function in sorted order. Returns false if none remain
+bool FunctionSorter::nextFunction(FunctionData& result)
+{
+  if (_runs.empty()) {
+    if (_nextFunction >= _functions.size())
+      return false;
+    result = _functions[_nextFunction];
+    _nextFunction++;
+    return true;
+  }
+  else if (_merge.empty())
+    return false;
+  else {
+    MergeEntry next = _merge.top();
+    _merge.pop();
+    result = next._data;
+    if (readFunction(_runs[next._run], next._data))
+      _merge.push(MergeEntry(next._data, next._run));
+    return true;
+  }
+}
@@ -0,0 +1,183 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functsorter.h Sorts function descriptions with a bounded amount of memory
+using std::priority_queue;
+
+/* This object sorts function descriptions for output. Normally they are all
+   held in memory and sorted at once. If a limit is set on the number held in
+   memory, they are sorted in groups no larger than the limit, and each sorted
+   group (a run) is written to a temporary file. Output then merges the runs.
+   Only a limited number of runs are merged at once, so if there are too many,
+   groups of them are merged into larger runs first. Temporary files are
+   deleted when the object is destroyed. If a run can't be written, or there
+   is no temporary file for it, the runs are read back and everything is
+   sorted in memory instead
+
+   Runs hold one record per function: the name, caller, and file name as a four
+   byte length and the text, then the line number (4 bytes) and flags (1 byte).
+   Numbers are little endian
+
+   Comparing functions compares strings, which is slow. Instead, each distinct
+   string is ranked once, and the functions are sorted by keys made of the
+   ranks of their strings and their other fields. These give the same order as
+   comparing the functions. Large groups are sorted in pieces on several
+   threads at once, and then the pieces are merged, also in parallel */
+class FunctionSorter
+{
+ private:
+  enum { _MaxMergeRuns = 32 }; // Max runs merged at once
+  enum { _MinThreadSort = 16384 }; // Fewest functions sorted by each thread
+
+  // Next function in a run being merged, and where it came from
+  class MergeEntry
+  {
+  public:
+    FunctionData _data;
+    unsigned int _run;
+
+    MergeEntry(const FunctionData& data, unsigned int run);
+
+    // Priority queues return the largest entry first, so this is reversed
+    bool operator<(const MergeEntry& other) const;
+  };
+
+  typedef priority_queue<MergeEntry> MergeQueue;
+
+  /* Sort key for a function. The fields hold, from most to least significant,
+     the same things FunctionData::operator< compares, in the same order */
+  struct SortKey
+  {
+    unsigned long long major; // Name, scope, and file for file scope functions
+    unsigned long long middle; // Declaration or not, file, and line
+    unsigned long long minor; // Caller, and refrence or not
+    unsigned int index; // Position of the function in the unsorted list
+
+    bool operator<(const SortKey& other) const;
+  };
+
+  typedef vector<SortKey>::iterator SortKeyIter;
+
+  vector<FunctionData> _functions; // Functions not yet written to a run
+  unsigned long _maxInMemory; // Zero for no limit
+  unsigned int _threadCount; // Threads to use for sorting
+  unsigned long _count; // Total functions added
+  vector<FILE*> _runs; // Temporary files holding sorted runs
+  unsigned int _nextFunction; // Next function to output, when there are no runs
+  MergeQueue _merge; // Next function from each run being output
+  bool _spillFailed; // True, a run could not be written
+  bool _readFailed; // True, a run could not be read back
+
+  // Sorts the functions in memory
+  void sortFunctions();
+
+  // Sorts the keys, using the given number of threads
+  static void sortKeys(SortKeyIter first, SortKeyIter last, unsigned int threadCount);
+
+  // Sorts one piece of the keys, on its own thread
+  static void sortPiece(SortKeyIter first, SortKeyIter last);
+
+  // Merges two adjacent sorted pieces of the keys, on its own thread
+  static void mergePieces(SortKeyIter first, SortKeyIter middle, SortKeyIter last);
+
+  // Sorts functions in memory and writes them as a new run
+  void writeRun();
+
+  // Merges the runs in the given range into a new run, replacing them
+  void mergeRuns(unsigned int first, unsigned int last);
+
+  /* Reads the runs back into memory and stops writing them, after a write fails
+     or a temporary file can't be created */
+  void stopSpilling();
+
+  /* Recreates the next function from the run. Returns false at the end of the
+     run, or if it can't be read */
+  bool readFunction(FILE* run, FunctionData& result);
+
+  // Returns false if the function can't be written
+  static bool writeFunction(FILE* run, const FunctionData& data);
+
+  // This object controls temporary files, so it can't be copied
+  FunctionSorter(const FunctionSorter& other);
+  FunctionSorter& operator=(const FunctionSorter& other);
+
+ public:
+  /* Constructor. Sets the max functions held in memory, zero for no limit,
+     and the number of threads to use for sorting */
+  FunctionSorter(unsigned long maxInMemory, unsigned int threadCount = 1);
+
+  // Destructor. Deletes any temporary files
+  ~FunctionSorter();
+
+  void add(const FunctionData& data);
+
+  // Returns true if no functions were added
+  bool empty() const;
+
+  // Prepares to output the functions. No more can be added afterward
+  void startOutput();
+
+  // Returns the next function in sorted order. Returns false if none remain
+  bool nextFunction(FunctionData& result);
+
+  // Returns true if a run could not be written, so all sorting was in memory
+  bool spillFailed() const;
+
+  // Returns true if a run could not be read back, so the output is incomplete
+  bool readFailed() const;
+};
+
+inline void FunctionSorter::add(const FunctionData& data)
+{
+  _functions.push_back(data);
+  _count++;
+  if ((_maxInMemory > 0) && (_functions.size() >= _maxInMemory))
+    writeRun();
+}
+
+inline bool FunctionSorter::SortKey::operator<(const SortKey& other) const
+{
+  if (major != other.major)
+    return (major < other.major);
+  else if (middle != other.middle)
+    return (middle < other.middle);
+  else
+    return (minor < other.minor);
+}
+
+// Returns true if no functions were added
+inline bool FunctionSorter::empty() const
+{
+  return (_count == 0);
+}
+
+// Returns true if a run could not be written, so all sorting was in memory
+inline bool FunctionSorter::spillFailed() const
+{
+  return _spillFailed;
+}
+
+// Returns true if a run could not be read back, so the output is incomplete
+inline bool FunctionSorter::readFailed() const
+{
+  return _readFailed;
+}
@@ -0,0 +1,222 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functwriter.cpp Writes the function table out quickly
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "basetypes.h"
+#include "functwriter.h"
+
+using std::string;
+using std::snprintf;
+
+FunctionWriter::FunctionWriter(ostream& output, FunctionWriter::Format format)
+    : _output(output), _format(format)
+{
+  // Room for the last row added after the buffer is nearly full
+  _buffer.reserve(_BufferSize + 4096);
+}
+
+// Destructor. Writes out anything not yet written
+FunctionWriter::~FunctionWriter()
+{
+  flush();
+}
+
+// Writes the buffer to the stream
+void FunctionWriter::flush()
+{
+  if (!_buffer.empty()) {
+    _output.write(_buffer.data(), _buffer.length());
+    _buffer.clear();
+  }
+}
+
+/* Returns the format with the given name (table, tsv, csv or json).
+   Returns false if there is no such format */
+bool FunctionWriter::findFormat(const string& name, FunctionWriter::Format& format)
+{
+  if (name == "table")
+    format = tableFormat;
+  else if (name == "tsv")
+    format = tsvFormat;
+  else if (name == "csv")
+    format = csvFormat;
+  else if (name == "json")
+    format = jsonFormat;
+  else
+    return false;
+  return true;
+}
+
+// Adds the text, padded with spaces to the given width
+void FunctionWriter::appendPadded(const string& text, string::size_type width)
+{
+  _buffer += text;
+  if (text.length() < width)
+    _buffer.append(width - text.length(), ' ');
+}
+
+void FunctionWriter::appendNumber(int value)
+{
+  char digits[12];
+  unsigned int count = 0;
+  // Negate as unsigned, so the smallest int works
+  unsigned int magnitude = (value < 0) ? (0U - (unsigned int)value) : (unsigned int)value;
+  do {
+    digits[count++] = (char)('0' + (magnitude % 10));
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0)
+    _buffer += '-';
+  while (count > 0)
+    _buffer += digits[--count];
+}
+
+// Adds the text as a field of the format used
+void FunctionWriter::appendField(const string& text)
+{
+  string::size_type index;
+  if (_format == tsvFormat) {
+    // Tabs and line ends would split the field, so they become spaces
+    for (index = 0; index < text.length(); index++)
+      if ((text[index] == '\t') || (text[index] == '\n') || (text[index] == '\r'))
+        _buffer += ' ';
+      else
+        _buffer += text[index];
+  }
+  else if (_format == csvFormat) {
+    // Quote fields holding anything special, doubling any quotes within
+    if (text.find_first_of(",\"\r\n") == string::npos)
+      _buffer += text;
+    else {
+      _buffer += '"';
+      for (index = 0; index < text.length(); index++) {
+        if (text[index] == '"')
+          _buffer += '"';
+        _buffer += text[index];
+      }
+      _buffer += '"';
+    }
+  }
+  else
+    appendJsonString(_buffer, text);
+}
+
+// Adds the text to the buffer as a JSON string, quoted and escaped
+void FunctionWriter::appendJsonString(string& buffer, const string& text)
+{
+  string::size_type index;
+  buffer += '"';
+  for (index = 0; index < text.length(); index++) {
+    unsigned char nextChar = text[index];
+    if ((nextChar == '"') || (nextChar == '\\')) {
+      buffer += '\\';
+      buffer += (char)nextChar;
+    }
+    else if (nextChar < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", nextChar);
+      buffer += escape;
+    }
+    else
+      buffer += (char)nextChar;
+  }
+  buffer += '"';
+}
+
+// Writes the column headings, if the format has them
+void FunctionWriter::writeHeadings()
+{
+  if (_format == tableFormat)
+    _buffer += "Function name         scope               caller                source          line\n";
+  else if (_format == tsvFormat)
+    _buffer += "name\tscope\tuse\tcaller\tfile\tline\n";
+  else if (_format == csvFormat)
+    _buffer += "name,scope,use,caller,file,line\n";
+}
+
+void FunctionWriter::add(const FunctionData& data)
+{
+  const char* scope = data.isFileScope() ? "file" : "global";
+  const char* use;
+  if (data.isDeclaration())
+    use = "declared";
+  else if (data.isRefrence())
+    use = "refrenced";
+  else
+    use = "called";
+
+  if (_format == tableFormat) {
+    // Same columns as FunctionData's output operator
+    appendPadded(data.getName().str(), 20);
+    _buffer += data.isFileScope() ? "  file   " : "  global ";
+    if (data.isDeclaration())
+      _buffer += "declared                         ";
+    else {
+      _buffer += data.isRefrence() ? "refrenced in " : "called from  ";
+      appendPadded(data.getCaller().str(), 20);
+    }
+    _buffer += "  ";
+    appendPadded(data.getFilePosition().getFileName(), 14);
+    _buffer += "  ";
+    appendNumber(data.getFilePosition().getLineNo());
+  }
+  else if (_format == jsonFormat) {
+    _buffer += "{\"name\":";
+    appendField(data.getName().str());
+    _buffer += ",\"scope\":\"";
+    _buffer += scope;
+    _buffer += "\",\"use\":\"";
+    _buffer += use;
+    _buffer += '"';
+    if (!data.isDeclaration()) {
+      _buffer += ",\"caller\":";
+      appendField(data.getCaller().str());
+    }
+    _buffer += ",\"file\":";
+    appendField(data.getFilePosition().getFileName());
+    _buffer += ",\"line\":";
+    appendNumber(data.getFilePosition().getLineNo());
+    _buffer += '}';
+  }
+  else {
+    char separator = (_format == tsvFormat) ? '\t' : ',';
+    appendField(data.getName().str());
+    _buffer += separator;
+    _buffer += scope;
+    _buffer += separator;
+    _buffer += use;
+    _buffer += separator;
+    if (!data.isDeclaration())
+      appendField(data.getCaller().str());
+    _buffer += separator;
+    appendField(data.getFilePosition().getFileName());
+    _buffer += separator;
+    appendNumber(data.getFilePosition().getLineNo());
+  }
+  _buffer += '\n';
+  checkFull();
+}
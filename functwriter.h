@@ -0,0 +1,85 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// functwriter.h Writes the function table out quickly
+
+/* This object writes the functions found, in the order given, as the usual
+   table or as tab separated, comma separated, or JSON (one object per line)
+   records for other programs to read. Each row is formatted directly into a
+   large buffer, which is written out once it fills, instead of through the
+   stream formatting, so writing millions of rows costs little. The buffer is
+   written out when the object is destroyed, or on request */
+class FunctionWriter
+{
+ public:
+  typedef enum { tableFormat, tsvFormat, csvFormat, jsonFormat } Format;
+
+ private:
+  enum { _BufferSize = 1 << 20 }; // Output written once this much is held
+
+  ostream& _output;
+  Format _format;
+  string _buffer;
+
+  // Adds the text, padded with spaces to the given width
+  void appendPadded(const string& text, string::size_type width);
+
+  // Adds the text as a field of the format used
+  void appendField(const string& text);
+
+  void appendNumber(int value);
+
+  // Writes out the buffer if it has filled
+  void checkFull();
+
+  // Copy constructor and assignment operator. This object can't be copied
+  FunctionWriter(const FunctionWriter& other);
+  const FunctionWriter& operator=(const FunctionWriter& other);
+
+ public:
+  FunctionWriter(ostream& output, Format format = tableFormat);
+
+  // Destructor. Writes out anything not yet written
+  ~FunctionWriter();
+
+  // Writes the column headings, if the format has them
+  void writeHeadings();
+
+  void add(const FunctionData& data);
+
+  // Writes the buffer to the stream
+  void flush();
+
+  /* Returns the format with the given name (table, tsv, csv or json).
+     Returns false if there is no such format */
+  static bool findFormat(const string& name, Format& format);
+
+  // Adds the text to the buffer as a JSON string, quoted and escaped
+  static void appendJsonString(string& buffer, const string& text);
+};
+
+// Writes out the buffer if it has filled
+inline void FunctionWriter::checkFull()
+{
+  if (_buffer.length() >= _BufferSize)
+    flush();
+}
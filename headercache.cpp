@@ -0,0 +1,68 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// headercache.cpp Keeps what excluded header text declares, across files
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "basetypes.h"
+#include "regionfilter.h"
+#include "headercache.h"
+
+using std::string;
+using std::vector;
+using std::lock_guard;
+
+// Returns the declarations of the region, or NULL if it is not stored
+const vector<Token>* HeaderCache::find(const InternedString& key) const
+{
+  lock_guard<mutex> guard(_lock);
+  RegionMap::const_iterator entry = _regions.find(key);
+  if (entry == _regions.end())
+    return NULL;
+  return &(entry->second);
+}
+
+// Stores the declarations of the region, unless another file already has
+void HeaderCache::store(const InternedString& key, const vector<Token>& declarations)
+{
+  lock_guard<mutex> guard(_lock);
+  // Files with the same region store the same tokens, so the first one wins
+  _regions.insert(RegionMap::value_type(key, declarations));
+}
+
+// Adds the interned text the stored regions refer to onto the list
+void HeaderCache::listText(vector<InternedString>& text) const
+{
+  lock_guard<mutex> guard(_lock);
+  RegionMap::const_iterator entry;
+  vector<Token>::const_iterator index;
+  for (entry = _regions.begin(); entry != _regions.end(); entry++) {
+    text.push_back(entry->first);
+    for (index = entry->second.begin(); index != entry->second.end(); index++) {
+      text.push_back(index->getInternedLexeme());
+      text.push_back(index->getFilePosition().getInternedFileName());
+    }
+  }
+}
@@ -0,0 +1,75 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// headercache.h Keeps what excluded header text declares, across files
+using std::mutex;
+using std::unordered_map;
+
+/* Every file that includes a system header repeats the header's text in its
+   preprocessor output, and excluded text is skimmed only for the names it
+   declares (see regionfilter.h). This object keeps those names for each
+   region of excluded text, so the next file with the same region adds them to
+   its symbol table instead of reading the region again.
+     A region runs from a line marker moving into excluded files to the next
+   one moving out of them. Its key holds the name and line of the first marker,
+   and the length and hash of the text, so only identical regions match. The
+   names are kept as the declaration tokens the skim found, in order. Regions
+   are never removed, so the tokens stay where they are once stored */
+class HeaderCache
+{
+ private:
+  typedef unordered_map<InternedString, vector<Token>, InternedStringHash> RegionMap;
+
+  const RegionFilter& _filter;
+  RegionMap _regions;
+  mutable mutex _lock;
+
+  // Copy constructor and assignment operator. This object can't be copied
+  HeaderCache(const HeaderCache& other);
+  const HeaderCache& operator=(const HeaderCache& other);
+
+ public:
+  HeaderCache(const RegionFilter& filter);
+
+  // The filter deciding which text is excluded
+  const RegionFilter& getFilter() const;
+
+  // Returns the declarations of the region, or NULL if it is not stored
+  const vector<Token>* find(const InternedString& key) const;
+
+  // Stores the declarations of the region, unless another file already has
+  void store(const InternedString& key, const vector<Token>& declarations);
+
+  // Adds the interned text the stored regions refer to onto the list
+  void listText(vector<InternedString>& text) const;
+};
+
+inline HeaderCache::HeaderCache(const RegionFilter& filter)
+    : _filter(filter)
+{
+}
+
+// The filter deciding which text is excluded
+inline const RegionFilter& HeaderCache::getFilter() const
+{
+  return _filter;
+}
@@ -0,0 +1,290 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexcache.cpp Stores the results of indexing files on disk
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <list>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include "basetypes.h"
+#include "indexstats.h"
+#include "errors.h"
+#include "filebuffer.h"
+#include "tokenizer.h"
+#include "namespace.h"
+#include "parser.h"
+#include "arena.h"
+#include "functfinder.h"
+#include "indexpool.h"
+#include "indexcache.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::ifstream;
+using std::ofstream;
+using std::istream;
+using std::ostringstream;
+using std::ios_base;
+
+typedef unsigned long long CacheNumber;
+
+// FNV-1a hash, used to name cache files
+static const CacheNumber _HashStart = 14695981039346656037ULL;
+static const CacheNumber _HashPrime = 1099511628211ULL;
+
+static void hashBytes(CacheNumber& hash, const char* data, size_t length)
+{
+  size_t index;
+  for (index = 0; index < length; index++) {
+    hash ^= (unsigned char)data[index];
+    hash *= _HashPrime;
+  }
+}
+
+// Writes a number of the given size in bytes, low byte first
+static void writeNumber(ostream& stream, CacheNumber value, unsigned int size)
+{
+  unsigned int index;
+  for (index = 0; index < size; index++) {
+    stream.put((char)(value & 0xFF));
+    value >>= 8;
+  }
+}
+
+static void writeText(ostream& stream, const string& text)
+{
+  writeNumber(stream, text.length(), 4);
+  stream.write(text.data(), text.length());
+}
+
+// Reads a number of the given size. Check the stream for errors afterward
+static CacheNumber readNumber(istream& stream, unsigned int size)
+{
+  CacheNumber value = 0;
+  unsigned int index;
+  for (index = 0; index < size; index++)
+    value |= ((CacheNumber)(unsigned char)stream.get()) << (8 * index);
+  return value;
+}
+
+// Returns the number of bytes left to read in the stream
+static CacheNumber findRemaining(istream& stream)
+{
+  istream::pos_type current = stream.tellg();
+  stream.seekg(0, ios_base::end);
+  istream::pos_type end = stream.tellg();
+  stream.seekg(current);
+  if ((!stream) || (end < current))
+    return 0;
+  return (CacheNumber)(end - current);
+}
+
+/* Reads text written by writeText. A length longer than the rest of the file
+   means it is corrupt, so the stream is failed instead of reading it */
+static bool readText(istream& stream, string& text)
+{
+  CacheNumber length = readNumber(stream, 4);
+  if (!stream)
+    return false;
+  if (length > findRemaining(stream)) {
+    stream.setstate(ios_base::failbit);
+    return false;
+  }
+  text.resize(length);
+  if (length > 0)
+    stream.read(&text[0], length);
+  return (bool)stream;
+}
+
+IndexCache::IndexCache(const string& directory)
+    : _directory(directory)
+{
+  if (_directory.empty())
+    _directory = ".";
+}
+
+/* Returns the name of the cache file for an input file. Returns an empty
+   string if the input file can't be read */
+string IndexCache::findCacheName(const string& fileName) const
+{
+  ifstream file(fileName.c_str(), ios_base::in | ios_base::binary);
+  if (!file.is_open())
+    return string();
+
+  // The results include the file name, so it is part of the hash
+  CacheNumber hash = _HashStart;
+  hashBytes(hash, fileName.c_str(), fileName.length() + 1); // Include the NUL
+  // Default options leave the hash alone, so existing cache files are still used
+  if (!_variant.empty())
+    hashBytes(hash, _variant.c_str(), _variant.length() + 1);
+  char buffer[65536];
+  while (file) {
+    file.read(buffer, sizeof(buffer));
+    hashBytes(hash, buffer, file.gcount());
+  }
+  if (!file.eof()) // Read failed
+    return string();
+
+  ostringstream cacheName;
+  cacheName << _directory << '/';
+  cacheName.width(16);
+  cacheName.fill('0');
+  cacheName << std::hex << hash << ".idx";
+  return cacheName.str();
+}
+
+// Loads results from the cache. Returns false if they are not there
+bool IndexCache::load(const string& cacheName, const string& fileName,
+                      FileResult& result) const
+{
+  ifstream cache(cacheName.c_str(), ios_base::in | ios_base::binary);
+  if (!cache.is_open())
+    return false;
+
+  char magic[4];
+  cache.read(magic, 4);
+  if ((!cache) || (string(magic, 4) != "PIDX") ||
+      (readNumber(cache, 4) != _FormatVersion))
+    return false;
+  // Guard against two files or option variants with the same hash
+  string cachedFileName;
+  string cachedVariant;
+  if ((!readText(cache, cachedFileName)) || (cachedFileName != fileName) ||
+      (!readText(cache, cachedVariant)) || (cachedVariant != _variant))
+    return false;
+
+  vector<InternedString> strings;
+  string text;
+  CacheNumber count = readNumber(cache, 4);
+  CacheNumber index;
+  // Each string takes at least its length, so a larger count is corrupt
+  if (count > (findRemaining(cache) / 4))
+    return false;
+  strings.reserve(count);
+  for (index = 0; (index < count) && cache; index++)
+    if (readText(cache, text))
+      strings.push_back(InternedString(text));
+  if ((!cache) || (strings.size() != count) || (!readText(cache, result.log)) ||
+      (!readText(cache, result.trailer)))
+    return false;
+
+  count = readNumber(cache, 4);
+  result.functions.clear();
+  // Each function takes 17 bytes
+  if ((!cache) || (count > (findRemaining(cache) / 17))) {
+    result = FileResult();
+    return false;
+  }
+  result.functions.reserve(count);
+  for (index = 0; (index < count) && cache; index++) {
+    CacheNumber name = readNumber(cache, 4);
+    CacheNumber caller = readNumber(cache, 4);
+    CacheNumber file = readNumber(cache, 4);
+    int lineNo = (int)readNumber(cache, 4);
+    int flags = (int)readNumber(cache, 1);
+    if ((name >= strings.size()) || (caller >= strings.size()) ||
+        (file >= strings.size()))
+      cache.setstate(ios_base::failbit); // Corrupt file
+    else
+      result.functions.push_back(FunctionData(strings[name],
+                                              FilePosition(strings[file], lineNo),
+                                              ((flags & 1) != 0), strings[caller],
+                                              ((flags & 2) != 0), ((flags & 4) != 0)));
+  }
+  if (!cache) {
+    // Leave the result as it was found, so the caller can index the file
+    result = FileResult();
+    return false;
+  }
+  else
+    return true;
+}
+
+// Stores results in the cache
+void IndexCache::store(const string& cacheName, const string& fileName,
+                       const FileResult& result) const
+{
+  // Build the string table. Strings are interned, so same text means same address
+  map<const string*, unsigned int> stringIndex;
+  vector<const string*> strings;
+  vector<FunctionData>::const_iterator functIndex;
+  for (functIndex = result.functions.begin(); functIndex != result.functions.end();
+       functIndex++) {
+    const string* values[3] = { &functIndex->getName().str(),
+                                &functIndex->getCaller().str(),
+                                &functIndex->getFilePosition().getFileName() };
+    unsigned int index;
+    for (index = 0; index < 3; index++)
+      if (stringIndex.insert(std::make_pair(values[index], strings.size())).second)
+        strings.push_back(values[index]);
+  }
+
+  /* Write to a temporary file and then rename it, so other runs sharing the
+     cache never see a partly written file */
+  ostringstream tempName;
+  tempName << cacheName << '.' << std::hex
+           << (std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+               (size_t)std::chrono::steady_clock::now().time_since_epoch().count())
+           << ".tmp";
+  ofstream cache(tempName.str().c_str(),
+                 ios_base::out | ios_base::binary | ios_base::trunc);
+  if (!cache.is_open())
+    return;
+  cache.write("PIDX", 4);
+  writeNumber(cache, _FormatVersion, 4);
+  writeText(cache, fileName);
+  writeText(cache, _variant);
+  writeNumber(cache, strings.size(), 4);
+  vector<const string*>::const_iterator stringPtr;
+  for (stringPtr = strings.begin(); stringPtr != strings.end(); stringPtr++)
+    writeText(cache, **stringPtr);
+  writeText(cache, result.log);
+  writeText(cache, result.trailer);
+  writeNumber(cache, result.functions.size(), 4);
+  for (functIndex = result.functions.begin(); functIndex != result.functions.end();
+       functIndex++) {
+    writeNumber(cache, stringIndex[&functIndex->getName().str()], 4);
+    writeNumber(cache, stringIndex[&functIndex->getCaller().str()], 4);
+    writeNumber(cache, stringIndex[&functIndex->getFilePosition().getFileName()], 4);
+    writeNumber(cache, functIndex->getFilePosition().getLineNo(), 4);
+    writeNumber(cache, (functIndex->isDeclaration() ? 1 : 0) |
+                       (functIndex->isRefrence() ? 2 : 0) |
+                       (functIndex->isFileScope() ? 4 : 0), 1);
+  }
+  cache.close();
+  if ((!cache) || (std::rename(tempName.str().c_str(), cacheName.c_str()) != 0))
+    std::remove(tempName.str().c_str());
+}
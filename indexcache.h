@@ -0,0 +1,78 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexcache.h Stores the results of indexing files on disk
+
+/* This object caches the results of indexing a file in a directory, so a file
+   which has not changed since the last run need not be indexed again. Each
+   input file has its own cache file, named by a hash of the input file name
+   and contents. Changing the file changes the name, so out of date results are
+   never found. The cache is only an optimization, so problems reading or
+   writing it just cause the file to be indexed normally.
+
+   Cache file layout. Numbers are little endian, strings are a four byte length
+   followed by the text:
+     "PIDX", format version (4 bytes)
+     input file name, options variant (see setVariant)
+     string table: count (4 bytes), then the strings
+     log text, trailer text
+     function count (4 bytes), then for each function: name, caller, and file
+       name as indexes into the string table (4 bytes each), line number
+       (4 bytes), flags (1 byte) */
+class IndexCache
+{
+ private:
+  /* Increase this whenever the output of the indexer changes, otherwise old
+     results will continue to be used */
+  enum { _FormatVersion = 3 };
+
+  string _directory;
+  string _variant; // Options that change the results, empty for the defaults
+
+ public:
+  IndexCache(const string& directory);
+
+  // This object uses the default copy constructor, assignment operator, and destructor
+
+  /* Sets text describing options that change the results. It is part of the
+     hash and is stored with the results, so results indexed with other
+     options are not used */
+  void setVariant(const string& variant);
+
+  /* Returns the name of the cache file for an input file. Returns an empty
+     string if the input file can't be read */
+  string findCacheName(const string& fileName) const;
+
+  // Loads results from the cache. Returns false if they are not there
+  bool load(const string& cacheName, const string& fileName,
+            FileResult& result) const;
+
+  // Stores results in the cache
+  void store(const string& cacheName, const string& fileName,
+             const FileResult& result) const;
+};
+
+// Sets text describing options that change the results
+inline void IndexCache::setVariant(const string& variant)
+{
+  _variant = variant;
+}
@@ -0,0 +1,203 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexpool.cpp Indexes a group of files on several threads at once
+
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <utility>
+#include <list>
+#include <set>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "basetypes.h"
+#include "indexstats.h"
+#include "errors.h"
+#include "filebuffer.h"
+#include "tokenizer.h"
+#include "namespace.h"
+#include "parser.h"
+#include "arena.h"
+#include "functfinder.h"
+#include "indexpool.h"
+#include "indexcache.h"
+#include "linker.h"
+#include "prefetcher.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::ostringstream;
+using std::lock_guard;
+using std::unique_lock;
+
+// Indexes one file, appending the functions found to the result
+void indexFile(FunctFinder& finder, const string& fileName,
+               vector<FunctionData>& result, ostream& log)
+{
+  IndexStats::_current.clear();
+  try {
+    finder.start(fileName);
+    while (!finder.haveEOF())
+      result.push_back(finder.nextFunction());
+  }
+  catch (exception& error) {
+    startWarning(log, processingError, FilePosition(fileName, 0), "")
+        << "Processing file " << fileName << " stopped early due to error: "
+        << error.what() << '\n';
+  }
+}
+
+/* Indexes one file into the result, including the warnings. If a cache is
+   given, the results are taken from it when possible, and stored otherwise */
+void indexFile(FunctFinder& finder, const string& fileName, FileResult& result,
+               const IndexCache* cache)
+{
+  string cacheName;
+  if (cache != NULL)
+    cacheName = cache->findCacheName(fileName);
+  if (cacheName.empty() || (!cache->load(cacheName, fileName, result))) {
+    result = FileResult();
+    ostringstream log;
+    finder.setLog(log);
+    indexFile(finder, fileName, result.functions, log);
+    result.log = log.str();
+
+    /* Some warnings are only issued when the next file is started. Force
+       them out now, so they stay with the file that caused them */
+    ostringstream trailer;
+    finder.setLog(trailer);
+    finder.finish();
+    result.trailer = trailer.str();
+    result.stats = IndexStats::_current;
+    finder.setLog(cout); // Log streams above are gone
+    if (!cacheName.empty())
+      cache->store(cacheName, fileName, result);
+  }
+}
+
+IndexPool::IndexPool(const vector<string>& fileNames)
+    : _fileNames(fileNames), _results(fileNames.size()),
+      _isDone(fileNames.size(), false), _nextFile(0), _released(0),
+      _maxAhead(1), _stopping(false), _cache(NULL), _pipelined(false),
+      _linker(NULL), _filter(NULL), _headerCache(NULL),
+      _prefetcher(NULL), _copyFiles(false)
+{
+}
+
+// Destructor. Waits for the worker threads to stop
+IndexPool::~IndexPool()
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _stopping = true;
+  }
+  _windowOpen.notify_all();
+  unsigned int index;
+  for (index = 0; index < _workers.size(); index++)
+    _workers[index].join();
+}
+
+// Returns the index of the next file to process, or the file count if none remain
+unsigned int IndexPool::takeNextFile()
+{
+  unique_lock<mutex> guard(_lock);
+  while ((!_stopping) && (_nextFile < _fileNames.size()) &&
+         (_nextFile >= (_released + _maxAhead)))
+    _windowOpen.wait(guard);
+  if ((!_stopping) && (_nextFile < _fileNames.size()))
+    return _nextFile++;
+  else
+    return _fileNames.size();
+}
+
+// Marks a file's result as available
+void IndexPool::markDone(unsigned int index)
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _isDone[index] = true;
+  }
+  _resultReady.notify_all();
+}
+
+// Processes files until none remain
+void IndexPool::worker()
+{
+  FunctFinder finder;
+  finder.setPipelined(_pipelined);
+  finder.setFilter(_filter);
+  finder.setHeaderCache(_headerCache);
+  finder.setCopyFiles(_copyFiles);
+  unsigned int fileIndex = takeNextFile();
+  while (fileIndex < _fileNames.size()) {
+    if (_prefetcher != NULL)
+      _prefetcher->advance(fileIndex);
+    indexFile(finder, _fileNames[fileIndex], _results[fileIndex], _cache);
+    if (_linker != NULL)
+      _linker->addFile(_results[fileIndex].functions);
+    markDone(fileIndex);
+    fileIndex = takeNextFile();
+  }
+}
+
+// Starts indexing the files, using the given number of threads
+void IndexPool::start(unsigned int threadCount)
+{
+  unsigned int index;
+
+  if (threadCount > _fileNames.size())
+    threadCount = _fileNames.size();
+  // Enough work queued that no thread waits for the caller in normal use
+  _maxAhead = threadCount * 4;
+  for (index = 0; index < threadCount; index++)
+    _workers.push_back(thread(&IndexPool::worker, this));
+}
+
+// Waits for and returns the results for a file
+const FileResult& IndexPool::waitForResult(unsigned int index)
+{
+  unique_lock<mutex> guard(_lock);
+  while (!_isDone[index])
+    _resultReady.wait(guard);
+  return _results[index];
+}
+
+// Frees the results for a file once the caller is done with them
+void IndexPool::releaseResult(unsigned int index)
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _results[index] = FileResult();
+    if (_released <= index)
+      _released = index + 1;
+  }
+  _windowOpen.notify_all();
+}
@@ -0,0 +1,175 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexpool.h Indexes a group of files on several threads at once
+using std::mutex;
+using std::condition_variable;
+using std::thread;
+
+class IndexCache;
+class FunctionLinker;
+class RegionFilter;
+class HeaderCache;
+class FilePrefetcher;
+
+// Indexes one file, appending the functions found to the result
+void indexFile(FunctFinder& finder, const string& fileName,
+               vector<FunctionData>& result, ostream& log);
+
+struct FileResult;
+
+/* Indexes one file into the result, including the warnings. If a cache is
+   given, the results are taken from it when possible, and stored otherwise */
+void indexFile(FunctFinder& finder, const string& fileName, FileResult& result,
+               const IndexCache* cache);
+
+/* The results from indexing a single file. Warnings are cached as text so
+   they can be output in the same order as a single threaded run */
+struct FileResult
+{
+  vector<FunctionData> functions;
+  string log; // Warnings and errors found while processing the file
+  string trailer; // Warnings reported after the file was processed
+  IndexStats stats; // Work done indexing the file, if statistics are collected
+};
+
+/* This object indexes a list of files using a pool of worker threads. Each
+   worker has its own FunctFinder, and takes the next unprocessed file from the
+   list when it finishes the last one. If a cache is used, files with results
+   in the cache are not indexed again.
+     Results are returned in file order as they become available. To keep
+   memory use bounded, workers only run a limited number of files ahead of the
+   oldest result the caller has not released */
+class IndexPool
+{
+ private:
+  const vector<string>& _fileNames;
+  vector<FileResult> _results;
+  vector<char> _isDone; // True, result for the file is available
+  unsigned int _nextFile; // Index of next file to process
+  unsigned int _released; // Number of results released by the caller
+  unsigned int _maxAhead; // Max files processed beyond the last released one
+  bool _stopping; // True, workers should not start more files
+  mutex _lock; // Protects all of the above
+  condition_variable _resultReady;
+  condition_variable _windowOpen; // Signaled when a result is released
+  vector<thread> _workers;
+  const IndexCache* _cache; // NULL if no cache is used
+  bool _pipelined; // True, each file is read and lexed on separate threads
+  FunctionLinker* _linker; // NULL if files are not linked
+  const RegionFilter* _filter; // NULL if every source file is indexed
+  HeaderCache* _headerCache; // NULL if excluded regions are not cached
+  FilePrefetcher* _prefetcher; // NULL if files are not read ahead
+  bool _copyFiles; // True, files are copied into memory instead of mapped
+
+  // Processes files until none remain
+  void worker();
+
+  // Returns the index of the next file to process, or the file count if none remain
+  unsigned int takeNextFile();
+
+  // Marks a file's result as available
+  void markDone(unsigned int index);
+
+  // This object controls threads, so it can't be copied
+  IndexPool(const IndexPool& other);
+  IndexPool& operator=(const IndexPool& other);
+
+ public:
+  IndexPool(const vector<string>& fileNames);
+
+  // Destructor. Waits for the worker threads to stop
+  ~IndexPool();
+
+  // Sets the cache of previous results to use, or NULL for none
+  void setCache(const IndexCache* cache);
+
+  // Sets whether each file is read and lexed on separate threads
+  void setPipelined(bool pipelined);
+
+  // Sets the linker each file's functions are added to, or NULL for none
+  void setLinker(FunctionLinker* linker);
+
+  // Sets the filter deciding which source files are indexed, or NULL for all of them
+  void setFilter(const RegionFilter* filter);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(HeaderCache* headerCache);
+
+  // Sets the object reading files ahead of the workers, or NULL for none
+  void setPrefetcher(FilePrefetcher* prefetcher);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
+
+  // Starts indexing the files, using the given number of threads
+  void start(unsigned int threadCount);
+
+  /* Waits for and returns the results for a file, indexed in the order passed
+     to the constructor. Results must be requested in that order */
+  const FileResult& waitForResult(unsigned int index);
+
+  // Frees the results for a file once the caller is done with them
+  void releaseResult(unsigned int index);
+};
+
+// Sets the cache of previous results to use, or NULL for none
+inline void IndexPool::setCache(const IndexCache* cache)
+{
+  _cache = cache;
+}
+
+// Sets whether each file is read and lexed on separate threads
+inline void IndexPool::setPipelined(bool pipelined)
+{
+  _pipelined = pipelined;
+}
+
+// Sets the linker each file's functions are added to, or NULL for none
+inline void IndexPool::setLinker(FunctionLinker* linker)
+{
+  _linker = linker;
+}
+
+// Sets the filter deciding which source files are indexed, or NULL for all of them
+inline void IndexPool::setFilter(const RegionFilter* filter)
+{
+  _filter = filter;
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void IndexPool::setHeaderCache(HeaderCache* headerCache)
+{
+  _headerCache = headerCache;
+}
+
+// Sets the object reading files ahead of the workers, or NULL for none
+inline void IndexPool::setPrefetcher(FilePrefetcher* prefetcher)
+{
+  _prefetcher = prefetcher;
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void IndexPool::setCopyFiles(bool copyFiles)
+{
+  _copyFiles = copyFiles;
+}
@@ -0,0 +1,390 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexserver.cpp Keeps the index of a group of files up to date as they change
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <list>
+#include <set>
+#include <map>
+#include <functional>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#define HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include "basetypes.h"
+#include "indexstats.h"
+#include "errors.h"
+#include "filebuffer.h"
+#include "tokenizer.h"
+#include "namespace.h"
+#include "parser.h"
+#include "arena.h"
+#include "functfinder.h"
+#include "indexpool.h"
+#include "indexcache.h"
+#include "functionindex.h"
+#include "callgraph.h"
+#include "regionfilter.h"
+#include "headercache.h"
+#include "diagnostics.h"
+#include "functwriter.h"
+#include "indexserver.h"
+
+using std::string;
+using std::vector;
+using std::set;
+using std::pair;
+using std::make_pair;
+using std::ostream;
+using std::endl;
+using std::getline;
+using std::lock_guard;
+
+IndexServer::IndexServer(const vector<string>& fileNames, DiagnosticSink& log)
+    : _files(fileNames.size()), _lookupStale(true), _graphStale(true), _cache(NULL),
+      _filter(NULL), _headerCache(NULL), _log(log),
+      _notifyHandle(-1),
+      _stopping(false), _keptText(0)
+{
+  unsigned int index;
+  for (index = 0; index < fileNames.size(); index++) {
+    _files[index].name = fileNames[index];
+    _files[index].modifyTime = 0;
+  }
+  // Watched files may be edited while they are read
+  _finder.setCopyFiles(true);
+}
+
+// Destructor. Stops watching the files
+IndexServer::~IndexServer()
+{
+#ifdef HAVE_INOTIFY
+  if (_notifyHandle >= 0)
+    close(_notifyHandle);
+#endif
+}
+
+// Returns the time the file was last modified, or zero if it can't be read
+time_t IndexServer::findModifyTime(const string& fileName)
+{
+  struct stat fileStats;
+  if (stat(fileName.c_str(), &fileStats) != 0)
+    return 0;
+  else
+    return fileStats.st_mtime;
+}
+
+// Replaces the entries for a file in the index
+void IndexServer::replaceResult(unsigned int fileIndex, const FileResult& result)
+{
+  vector<FunctionSet::iterator>& entries = _files[fileIndex].entries;
+  unsigned int index;
+  for (index = 0; index < entries.size(); index++)
+    _index.erase(entries[index]);
+  entries.clear();
+  _lookupStale = true;
+  _graphStale = true;
+  entries.reserve(result.functions.size());
+  for (index = 0; index < result.functions.size(); index++)
+    entries.push_back(_index.insert(result.functions[index]));
+}
+
+// Indexes all of the files, using the given number of threads
+void IndexServer::load(unsigned int threadCount)
+{
+  vector<string> fileNames;
+  unsigned int index;
+  /* Get the times before indexing, so a file that changes while being indexed
+     is indexed again */
+  for (index = 0; index < _files.size(); index++) {
+    fileNames.push_back(_files[index].name);
+    _files[index].modifyTime = findModifyTime(_files[index].name);
+  }
+  startWatch();
+
+  IndexPool workers(fileNames);
+  workers.setCache(_cache);
+  workers.setFilter(_filter);
+  workers.setHeaderCache(_headerCache);
+  workers.setCopyFiles(true);
+  workers.start(threadCount);
+  for (index = 0; index < _files.size(); index++) {
+    const FileResult& result = workers.waitForResult(index);
+    _log.write(result.log);
+    _log.write(result.trailer);
+    replaceResult(index, result);
+    workers.releaseResult(index);
+  }
+  // Text found from now on is freed once it is no longer used
+  InternedString::seal();
+}
+
+// Indexes a file again, after it changed
+void IndexServer::reindex(unsigned int fileIndex)
+{
+  FileResult result;
+  WatchedFile& file = _files[fileIndex];
+  file.modifyTime = findModifyTime(file.name);
+  indexFile(_finder, file.name, result, _cache);
+  _log.write(result.log);
+  _log.write(result.trailer);
+  replaceResult(fileIndex, result);
+}
+
+// Indexes any files whose modification time changed
+void IndexServer::checkModifyTimes()
+{
+  /* NOTE: Times only change once a second, so a file changed twice within a
+     second of being indexed may be missed. Watching avoids this */
+  unsigned int index;
+  for (index = 0; index < _files.size(); index++)
+    if (findModifyTime(_files[index].name) != _files[index].modifyTime)
+      reindex(index);
+}
+
+// Frees the interned text no longer in use, once enough of it builds up
+void IndexServer::releaseText()
+{
+  if (InternedString::unsealedCount() < ((2 * _keptText) + _MinReleaseText))
+    return;
+  /* Once a file is finished the finder refers to no text it will use again,
+     and the lookup objects are built only from the index */
+  vector<InternedString> keep;
+  FunctionSet::const_iterator index;
+  for (index = _index.begin(); index != _index.end(); index++) {
+    keep.push_back(index->getName());
+    keep.push_back(index->getCaller());
+    keep.push_back(index->getFilePosition().getInternedFileName());
+  }
+  if (_headerCache != NULL)
+    _headerCache->listText(keep);
+  InternedString::collect(keep);
+  _keptText = InternedString::unsealedCount();
+}
+
+// Starts watching the directories holding the files for changes
+void IndexServer::startWatch()
+{
+#ifdef HAVE_INOTIFY
+  /* Editors often save a file by writing a new one and renaming it over the
+     old one, which would end a watch on the file itself. Watching directories
+     catches this. Each directory is only watched once, no matter how many
+     times it is added */
+  const uint32_t changeEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+  _notifyHandle = inotify_init();
+  if (_notifyHandle < 0)
+    return; // Modification times are checked instead
+  unsigned int index;
+  for (index = 0; index < _files.size(); index++) {
+    const string& fileName = _files[index].name;
+    string::size_type nameStart = fileName.rfind('/');
+    string directory = ".";
+    if (nameStart == 0)
+      directory = "/";
+    else if (nameStart != string::npos)
+      directory = fileName.substr(0, nameStart);
+    nameStart = (nameStart == string::npos) ? 0 : (nameStart + 1);
+    int watchHandle = inotify_add_watch(_notifyHandle, directory.c_str(), changeEvents);
+    if (watchHandle < 0) {
+      // If any file can't be watched, use modification times for all of them
+      close(_notifyHandle);
+      _notifyHandle = -1;
+      _watchNames.clear();
+      return;
+    }
+    _watchNames[make_pair(watchHandle, fileName.substr(nameStart))].push_back(index);
+  }
+#endif
+}
+
+// Waits for file change events and handles them, until told to stop
+void IndexServer::watch()
+{
+#ifdef HAVE_INOTIFY
+  alignas(struct inotify_event) char buffer[4096];
+  while (true) {
+    {
+      lock_guard<mutex> guard(_lock);
+      if (_stopping)
+        return;
+    }
+    // Wake up regularly to check for a request to stop
+    struct pollfd request = { _notifyHandle, POLLIN, 0 };
+    if (poll(&request, 1, 250) <= 0)
+      continue;
+    ssize_t length = read(_notifyHandle, buffer, sizeof(buffer));
+    if (length <= 0)
+      continue;
+
+    // A single save often causes several events, so only index each file once
+    set<unsigned int> changed;
+    const char* eventData = buffer;
+    while (eventData < (buffer + length)) {
+      const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(eventData);
+      if (event->len > 0) {
+        WatchNames::const_iterator file =
+            _watchNames.find(make_pair(event->wd, string(event->name)));
+        if (file != _watchNames.end())
+          changed.insert(file->second.begin(), file->second.end());
+      }
+      eventData += sizeof(struct inotify_event) + event->len;
+    }
+    lock_guard<mutex> guard(_lock);
+    set<unsigned int>::const_iterator fileIndex;
+    for (fileIndex = changed.begin(); fileIndex != changed.end(); fileIndex++)
+      reindex(*fileIndex);
+    releaseText();
+  }
+#endif
+}
+
+// Answers one query. Returns false if the server should stop
+bool IndexServer::answer(const string& query, ostream& output)
+{
+  // Queries are a command, optionally followed by spaces and an argument
+  string::size_type split = query.find(' ');
+  string command = query.substr(0, split);
+  string argument;
+  if (split != string::npos) {
+    split = query.find_first_not_of(' ', split);
+    if (split != string::npos)
+      argument = query.substr(split);
+  }
+  FunctionSet::const_iterator index;
+  FunctionIndex::Range found;
+  FunctionIndex::FunctionList::const_iterator foundIndex;
+  FunctionIndex::NameRange names;
+  vector<string> reached;
+  vector<string>::const_iterator reachedIndex;
+
+  if ((command == "declared") || (command == "callers") ||
+      (command == "callees") || (command == "file") ||
+      (command == "reachable") || (command == "impact")) {
+    /* These use the lookup object or the graph. Rebuild each only when a
+       query needs it after something changed, not every time a file changes.
+       The index is already sorted, so the lookup object uses it directly */
+    InternedString name(argument);
+    if ((command == "reachable") || (command == "impact")) {
+      if (_graphStale) {
+        _graph.clear();
+        for (index = _index.begin(); index != _index.end(); index++)
+          _graph.add(*index);
+        _graph.build();
+        _graphStale = false;
+      }
+      _graph.findReachable(name, (command == "impact"), reached);
+      for (reachedIndex = reached.begin(); reachedIndex != reached.end(); reachedIndex++)
+        output << *reachedIndex << endl;
+    }
+    else {
+      if (_lookupStale) {
+        _lookup.build(_index);
+        _lookupStale = false;
+      }
+      if (command == "callees") {
+        for (names = _lookup.findCallees(name); names.first != names.second; names.first++)
+          output << names.first->str() << endl;
+      }
+      else {
+        if (command == "declared")
+          found = _lookup.findDeclarations(name);
+        else if (command == "callers")
+          found = _lookup.findCalls(name);
+        else
+          found = _lookup.findInFile(name);
+        FunctionWriter writer(output);
+        for (foundIndex = found.first; foundIndex != found.second; foundIndex++)
+          writer.add(**foundIndex);
+      }
+    }
+    return true;
+  }
+
+  if (command == "list") {
+    if (_index.empty())
+      output << "No functions were found!" << endl;
+    else {
+      FunctionWriter writer(output);
+      writer.writeHeadings();
+      for (index = _index.begin(); index != _index.end(); index++)
+        writer.add(*index);
+    }
+  }
+  else if (command == "find") {
+    /* Entries are sorted by name first, and this sorts before every other
+       entry with the same name */
+    FunctionData first(InternedString(argument), FilePosition(InternedString(), 0),
+                       true, InternedString(), false, true);
+    FunctionWriter writer(output);
+    for (index = _index.lower_bound(first);
+         (index != _index.end()) && (index->getName() == first.getName()); index++)
+      writer.add(*index);
+  }
+  else if (command == "quit")
+    return false;
+  else if (!command.empty())
+    output << "Unknown query " << query << " ignored" << endl;
+  return true;
+}
+
+// Answers queries from the input until told to stop or the input ends
+void IndexServer::run(istream& input, ostream& output)
+{
+  thread watcher;
+  string query;
+  bool keepGoing = true;
+
+  if (_notifyHandle >= 0)
+    watcher = thread(&IndexServer::watch, this);
+  while (keepGoing && getline(input, query)) {
+    // Ignore trailing spaces, and the return from lines ended DOS style
+    query.erase(query.find_last_not_of(" \t\r") + 1);
+    lock_guard<mutex> guard(_lock);
+    if (_notifyHandle < 0)
+      checkModifyTimes();
+    keepGoing = answer(query, output);
+    output << "END" << endl; // Also flushes the answer to the caller
+    releaseText();
+  }
+  {
+    lock_guard<mutex> guard(_lock);
+    _stopping = true;
+  }
+  if (watcher.joinable())
+    watcher.join();
+}
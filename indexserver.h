@@ -0,0 +1,156 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexserver.h Keeps the index of a group of files up to date as they change
+using std::multiset;
+using std::map;
+using std::istream;
+
+class DiagnosticSink; // Writes out warnings, see diagnostics.h
+
+/* This object indexes a group of files, then keeps the results in memory and
+   answers queries about them until told to stop. The files are watched for
+   changes, through inotify where it exists, otherwise by checking modification
+   times before each query. Only files that change are indexed again, and their
+   entries in the sorted index are replaced without sorting everything again.
+
+   Queries are read one per line, and answered on the output stream. This lets
+   an editor or other tool keep one server running over a pipe:
+     list           Outputs the entire index, in the same format as a normal run
+     find [name]    Outputs the entries for one function
+     declared [name]  Outputs the declarations of a function
+     callers [name] Outputs the calls to a function
+     callees [name] Outputs the names of the functions a function calls
+     reachable [name] Outputs the names of the functions a function calls,
+                    directly or indirectly
+     impact [name]  Outputs the names of the functions that call a function,
+                    directly or indirectly
+     file [name]    Outputs the entries found in a source file
+     quit           Stops the server
+   Each answer ends with a line containing only END. Warnings found while
+   indexing go to the diagnostic sink.
+     Edits and queries keep adding new names to the interned strings (see
+   basetypes.h). Once the text found after loading grows to twice what the
+   index uses, the text no longer used is freed, so memory use stays bounded */
+class IndexServer
+{
+ private:
+  typedef multiset<FunctionData> FunctionSet;
+  // A file given under several names, such as a.i and ./a.i, has several entries
+  typedef map<pair<int, string>, vector<unsigned int> > WatchNames;
+
+  // Unused text that may build up before it is freed, beyond the text in use
+  static const size_t _MinReleaseText = 4096;
+
+  struct WatchedFile
+  {
+    string name;
+    time_t modifyTime; // Zero if the file could not be read
+    vector<FunctionSet::iterator> entries; // Functions from this file in the index
+  };
+
+  vector<WatchedFile> _files;
+  FunctionSet _index;
+  FunctionIndex _lookup; // Answers the more detailed queries
+  CallGraph _graph; // Answers the queries that follow calls
+  bool _lookupStale; // True, lookup must be rebuilt before it is used
+  bool _graphStale; // True, graph must be rebuilt before it is used
+  FunctFinder _finder; // Used to index changed files
+  const IndexCache* _cache; // NULL if no cache is used
+  const RegionFilter* _filter; // NULL if every source file is indexed
+  HeaderCache* _headerCache; // NULL if excluded regions are not cached
+  DiagnosticSink& _log;
+  int _notifyHandle; // Source of file change events, negative if not used
+  WatchNames _watchNames; // Files for each watched directory and name
+  bool _stopping; // True, the watch thread should stop
+  size_t _keptText; // Texts in use when unused text was last freed
+  mutex _lock; // Protects everything above from the watch thread
+
+  // Replaces the entries for a file in the index
+  void replaceResult(unsigned int fileIndex, const FileResult& result);
+
+  // Indexes a file again, after it changed
+  void reindex(unsigned int fileIndex);
+
+  // Starts watching the directories holding the files for changes
+  void startWatch();
+
+  // Waits for file change events and handles them, until told to stop
+  void watch();
+
+  // Indexes any files whose modification time changed
+  void checkModifyTimes();
+
+  // Frees the interned text no longer in use, once enough of it builds up
+  void releaseText();
+
+  // Answers one query. Returns false if the server should stop
+  bool answer(const string& query, ostream& output);
+
+  // Returns the time the file was last modified, or zero if it can't be read
+  static time_t findModifyTime(const string& fileName);
+
+  // This object controls a thread, so it can't be copied
+  IndexServer(const IndexServer& other);
+  IndexServer& operator=(const IndexServer& other);
+
+ public:
+  IndexServer(const vector<string>& fileNames, DiagnosticSink& log);
+
+  // Destructor. Stops watching the files
+  ~IndexServer();
+
+  // Sets the cache of previous results to use, or NULL for none
+  void setCache(const IndexCache* cache);
+
+  // Sets the filter deciding which source files are indexed, or NULL for all of them
+  void setFilter(const RegionFilter* filter);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(HeaderCache* headerCache);
+
+  // Indexes all of the files, using the given number of threads
+  void load(unsigned int threadCount);
+
+  // Answers queries from the input until told to stop or the input ends
+  void run(istream& input, ostream& output);
+};
+
+// Sets the cache of previous results to use, or NULL for none
+inline void IndexServer::setCache(const IndexCache* cache)
+{
+  _cache = cache;
+}
+
+// Sets the filter deciding which source files are indexed, or NULL for all of them
+inline void IndexServer::setFilter(const RegionFilter* filter)
+{
+  _filter = filter;
+  _finder.setFilter(filter);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void IndexServer::setHeaderCache(HeaderCache* headerCache)
+{
+  _headerCache = headerCache;
+  _finder.setHeaderCache(headerCache);
+}
@@ -0,0 +1,84 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexstats.cpp Counters and timers for each stage of indexing
+
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include "basetypes.h"
+#include "indexstats.h"
+
+using std::string;
+using std::ostream;
+using std::endl;
+using std::fixed;
+using std::setprecision;
+
+thread_local IndexStats IndexStats::_current;
+#ifdef INDEX_STATS
+thread_local StageTimer* StageTimer::_running = NULL;
+#endif
+
+void IndexStats::clear()
+{
+  unsigned int index;
+  bytes = 0;
+  lines = 0;
+  tokens = 0;
+  lookups = 0;
+  holds = 0;
+  peakHolds = 0;
+  for (index = 0; index < StageCount; index++)
+    nanoseconds[index] = 0;
+}
+
+// Adds another set of statistics to this one
+void IndexStats::add(const IndexStats& other)
+{
+  unsigned int index;
+  bytes += other.bytes;
+  lines += other.lines;
+  tokens += other.tokens;
+  lookups += other.lookups;
+  holds += other.holds;
+  if (peakHolds < other.peakHolds)
+    peakHolds = other.peakHolds;
+  for (index = 0; index < StageCount; index++)
+    nanoseconds[index] += other.nanoseconds[index];
+}
+
+void IndexStats::write(ostream& output, const string& title) const
+{
+  static const char* stageNames[StageCount] = { "lines", "tokens", "symbols",
+                                                "parsing", "holds" };
+  unsigned int index;
+  output << "Statistics for " << title << ": " << bytes << " bytes, " << lines
+         << " lines, " << tokens << " tokens, " << lookups << " lookups, "
+         << holds << " holds, peak of " << peakHolds << " held" << endl
+         << "  Time:" << fixed << setprecision(4);
+  for (index = 0; index < StageCount; index++)
+    output << " " << stageNames[index] << " " << (nanoseconds[index] / 1e9) << " s";
+  output << endl;
+}
@@ -0,0 +1,111 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// indexstats.h Counters and timers for each stage of indexing
+
+/* This object counts the work done indexing a file, and the time spent in each
+   stage. Each thread keeps its own counts, so no locking is needed. Times are
+   for the stage itself, not counting the stages it calls.
+     Statistics are only collected when the program is built with INDEX_STATS
+   defined. Otherwise the macros below do nothing, so they cost nothing */
+struct IndexStats
+{
+  enum Stage { lineStage, tokenStage, symbolStage, parseStage, holdStage, StageCount };
+
+  unsigned long long bytes; // Input read
+  unsigned long lines;
+  unsigned long tokens;
+  unsigned long lookups; // Identifiers checked against the symbol table
+  unsigned long holds; // Function calls held until their scope is known
+  unsigned long peakHolds; // Most calls held at once
+  unsigned long long nanoseconds[StageCount];
+
+  // Stats for the file being processed by this thread
+  static thread_local IndexStats _current;
+
+  void clear();
+
+  // Adds another set of statistics to this one
+  void add(const IndexStats& other);
+
+  void write(ostream& output, const string& title) const;
+};
+
+#ifdef INDEX_STATS
+/* Times a stage, from creation until destruction. Time spent in stages started
+   within it is subtracted, so each stage only counts its own time */
+class StageTimer
+{
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  IndexStats::Stage _stage;
+  Clock::time_point _start;
+  unsigned long long _childTime; // Time taken by stages started within this one
+  StageTimer* _parent; // Stage running when this one started
+
+  static thread_local StageTimer* _running;
+
+  // Objects of this class time a specific scope, so they can't be copied
+  StageTimer(const StageTimer& other);
+  StageTimer& operator=(const StageTimer& other);
+
+ public:
+  StageTimer(IndexStats::Stage stage);
+  ~StageTimer();
+};
+
+inline StageTimer::StageTimer(IndexStats::Stage stage)
+    : _stage(stage), _start(Clock::now()), _childTime(0), _parent(_running)
+{
+  _running = this;
+}
+
+inline StageTimer::~StageTimer()
+{
+  unsigned long long elapsed =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count();
+  IndexStats::_current.nanoseconds[_stage] += elapsed - _childTime;
+  if (_parent != NULL)
+    _parent->_childTime += elapsed;
+  _running = _parent;
+}
+
+#define STATS_TIMER(stage) StageTimer statsTimer(IndexStats::stage)
+#define STATS_COUNT(counter, amount) (IndexStats::_current.counter += (amount))
+#define STATS_PEAK(counter, value) \
+  do { if (IndexStats::_current.counter < (value)) IndexStats::_current.counter = (value); } while (false)
+#else
+#define STATS_TIMER(stage)
+#define STATS_COUNT(counter, amount)
+#define STATS_PEAK(counter, value)
+#endif
+
+// Returns true if the program was built to collect statistics
+inline bool haveIndexStats()
+{
+#ifdef INDEX_STATS
+  return true;
+#else
+  return false;
+#endif
+}
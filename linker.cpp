@@ -0,0 +1,192 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// linker.cpp Checks functions across all the files indexed
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include "basetypes.h"
+#include "errors.h"
+#include "linker.h"
+
+using std::string;
+using std::vector;
+using std::ostringstream;
+using std::sort;
+using std::unique;
+using std::thread;
+using std::ref;
+using std::lock_guard;
+
+FunctionLinker::Problem::Problem(const InternedString& newName,
+                                 const FilePosition& newLocation,
+                                 const string& newText)
+    : name(newName), location(newLocation), text(newText)
+{
+}
+
+bool FunctionLinker::Problem::operator<(const Problem& other) const
+{
+  if (name < other.name)
+    return true;
+  else if (name > other.name)
+    return false;
+  else
+    return (location < other.location);
+}
+
+FunctionLinker::FunctionLinker()
+{
+}
+
+// Sorts a list of locations and removes duplicates
+void FunctionLinker::sortUnique(vector<FilePosition>& locations)
+{
+  sort(locations.begin(), locations.end());
+  locations.erase(unique(locations.begin(), locations.end()), locations.end());
+}
+
+/* Checks one symbol, adding any problems found to the list. A function defined
+   in a header appears once for every file including it, at the same location,
+   so duplicate locations are not collisions */
+void FunctionLinker::checkSymbol(const InternedString& name, Symbol& symbol,
+                                 vector<Problem>& problems)
+{
+  vector<FilePosition>::const_iterator index;
+
+  sortUnique(symbol.globals);
+  sortUnique(symbol.statics);
+  sortUnique(symbol.calls);
+  if (!symbol.globals.empty()) {
+    const FilePosition& first = symbol.globals.front();
+    for (index = symbol.globals.begin() + 1; index != symbol.globals.end(); index++) {
+      ostringstream text;
+      startWarning(text, duplicateGlobal, *index, name.str())
+        << "WARNING: Function " << name.str() << " found " << *index
+        << " is also declared " << first << '\n';
+      problems.push_back(Problem(name, *index, text.str()));
+    }
+    for (index = symbol.statics.begin(); index != symbol.statics.end(); index++) {
+      ostringstream text;
+      startWarning(text, staticGlobal, *index, name.str())
+        << "WARNING: Static function " << name.str() << " found " << *index
+        << " has the same name as global function declared " << first << '\n';
+      problems.push_back(Problem(name, *index, text.str()));
+    }
+  }
+  else if (!symbol.statics.empty())
+    // No global function to call, so the call can't be resolved when linked
+    for (index = symbol.calls.begin(); index != symbol.calls.end(); index++) {
+      ostringstream text;
+      startWarning(text, staticCall, *index, name.str())
+        << "WARNING: Call to " << name.str() << " found " << *index
+        << " has no global declaration, but a static function is declared "
+        << symbol.statics.front() << '\n';
+      problems.push_back(Problem(name, *index, text.str()));
+    }
+}
+
+// Checks every shard with the given index modulo the step
+void FunctionLinker::checkShards(unsigned int first, unsigned int step,
+                                 vector<Problem>& problems)
+{
+  unsigned int index;
+  SymbolMap::iterator symbol;
+
+  for (index = first; index < _ShardCount; index += step) {
+    SymbolMap& symbols = _shards[index].symbols;
+    for (symbol = symbols.begin(); symbol != symbols.end(); symbol++)
+      checkSymbol(symbol->first, symbol->second, problems);
+    symbols.clear();
+  }
+}
+
+// Adds the functions found in a file. Can be called from several threads
+void FunctionLinker::addFile(const vector<FunctionData>& functions)
+{
+  vector<const FunctionData*> byShard[_ShardCount];
+  vector<FunctionData>::const_iterator function;
+  vector<const FunctionData*>::const_iterator entry;
+  unsigned int index;
+
+  // Calls resolved within their file can't cause problems between files
+  for (function = functions.begin(); function != functions.end(); function++)
+    if (function->isDeclaration() || (!function->isFileScope()))
+      byShard[shardIndex(function->getName())].push_back(&(*function));
+
+  // Group the functions first, so each lock is only taken once
+  for (index = 0; index < _ShardCount; index++)
+    if (!byShard[index].empty()) {
+      lock_guard<mutex> guard(_shards[index].lock);
+      SymbolMap& symbols = _shards[index].symbols;
+      for (entry = byShard[index].begin(); entry != byShard[index].end(); entry++) {
+        Symbol& symbol = symbols[(*entry)->getName()];
+        const FilePosition& location = (*entry)->getFilePosition();
+        if (!(*entry)->isDeclaration()) {
+          // Only the first call in each file is needed
+          if (symbol.calls.empty() ||
+              (symbol.calls.back().getInternedFileName() != location.getInternedFileName()))
+            symbol.calls.push_back(location);
+        }
+        else if ((*entry)->isFileScope())
+          symbol.statics.push_back(location);
+        else
+          symbol.globals.push_back(location);
+      }
+    }
+}
+
+/* Checks all the functions added, using the given number of threads, and
+   outputs the problems found ordered by name. Empties the table */
+void FunctionLinker::link(ostream& log, unsigned int threadCount)
+{
+  vector<vector<Problem> > problems;
+  vector<thread> threads;
+  vector<Problem> allProblems;
+  unsigned int index;
+
+  if (threadCount < 1)
+    threadCount = 1;
+  else if (threadCount > _ShardCount)
+    threadCount = _ShardCount;
+  problems.resize(threadCount);
+  for (index = 1; index < threadCount; index++)
+    threads.push_back(thread(&FunctionLinker::checkShards, this, index,
+                             threadCount, ref(problems[index])));
+  checkShards(0, threadCount, problems[0]);
+  for (index = 0; index < threads.size(); index++)
+    threads[index].join();
+
+  for (index = 0; index < threadCount; index++)
+    allProblems.insert(allProblems.end(), problems[index].begin(),
+                       problems[index].end());
+  sort(allProblems.begin(), allProblems.end());
+  for (index = 0; index < allProblems.size(); index++)
+    log << allProblems[index].text;
+}
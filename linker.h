@@ -0,0 +1,111 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// linker.h Checks functions across all the files indexed
+using std::mutex;
+using std::unordered_map;
+
+/* This object finds problems with functions that can only be seen once all
+   files are indexed. Each file's symbol table is thrown away when the file
+   ends, so calls still on hold get global scope, and collisions between files
+   are never checked. The linker collects the global declarations, file scope
+   declarations, and global calls from every file into one symbol table, and
+   then reports:
+     Global functions declared in more than one place
+     Static functions with the same name as a global function
+     Global calls that only match a static function in some other file
+   The table is split into shards by name, each with its own lock, so files
+   can be added from several threads at once. Each shard is checked on its
+   own, so the check also runs in parallel, and the time taken is linear in
+   the number of functions */
+class FunctionLinker
+{
+ private:
+  // Everything found for one name. Calls are only kept once per file
+  struct Symbol
+  {
+    vector<FilePosition> globals;
+    vector<FilePosition> statics;
+    vector<FilePosition> calls;
+  };
+
+  typedef unordered_map<InternedString, Symbol, InternedStringHash> SymbolMap;
+
+  struct Shard
+  {
+    mutex lock;
+    SymbolMap symbols;
+  };
+
+  // A problem found, kept so they can be output in a fixed order
+  struct Problem
+  {
+    InternedString name;
+    FilePosition location;
+    string text;
+
+    Problem(const InternedString& newName, const FilePosition& newLocation,
+            const string& newText);
+
+    bool operator<(const Problem& other) const;
+  };
+
+  static const unsigned int _ShardCount = 64;
+
+  Shard _shards[_ShardCount];
+
+  // Returns the shard holding a name
+  static unsigned int shardIndex(const InternedString& name);
+
+  // Sorts a list of locations and removes duplicates
+  static void sortUnique(vector<FilePosition>& locations);
+
+  // Checks one symbol, adding any problems found to the list
+  static void checkSymbol(const InternedString& name, Symbol& symbol,
+                          vector<Problem>& problems);
+
+  // Checks every shard with the given index modulo the step
+  void checkShards(unsigned int first, unsigned int step,
+                   vector<Problem>& problems);
+
+  // This object holds locks, so it can't be copied
+  FunctionLinker(const FunctionLinker& other);
+  FunctionLinker& operator=(const FunctionLinker& other);
+
+ public:
+  FunctionLinker();
+
+  // This object uses the default destructor
+
+  // Adds the functions found in a file. Can be called from several threads
+  void addFile(const vector<FunctionData>& functions);
+
+  /* Checks all the functions added, using the given number of threads, and
+     outputs the problems found ordered by name. Empties the table */
+  void link(ostream& log, unsigned int threadCount);
+};
+
+// Returns the shard holding a name
+inline unsigned int FunctionLinker::shardIndex(const InternedString& name)
+{
+  return name.hash() % _ShardCount;
+}
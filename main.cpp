@@ -32,63 +32,481 @@
 
 #include<iostream>
 #include<fstream>
+#include<sstream>
 #include<string>
 #include<vector>
+#include<utility>
 #include<list>
 #include<algorithm>
 #include<set>
 #include<map>
+#include<functional>
+#include<unordered_map>
+#include<mutex>
+#include<condition_variable>
+#include<thread>
+#include<cstdlib>
+#include<ctime>
+#include<cstring>
+#include<cstdio>
+#include<queue>
+#include<chrono>
 #include"basetypes.h"
+#include"indexstats.h"
 #include"errors.h"
 #include"filebuffer.h"
 #include"tokenizer.h"
 #include"namespace.h"
 #include"parser.h"
+#include"arena.h"
 #include"functfinder.h"
+#include"indexpool.h"
+#include"indexcache.h"
+#include"functsorter.h"
+#include"functwriter.h"
+#include"benchmark.h"
+#include"functionindex.h"
+#include"callgraph.h"
+#include"regionfilter.h"
+#include"headercache.h"
+#include"indexserver.h"
+#include"binaryindex.h"
+#include"linker.h"
+#include"prefetcher.h"
+#include"diagnostics.h"
 
 using std::cout;
+using std::cerr;
+using std::cin;
 using std::endl;
 using std::vector;
 using std::stringstream;
+using std::ostringstream;
+using std::ofstream;
+using std::ifstream;
+using std::istream;
+using std::getline;
+using std::atoi;
+using std::atof;
+using std::strtoul;
+using std::strtod;
+using std::strncmp;
+using std::strcmp;
 
 typedef vector<FunctionData> FuncDataVect;
 
+/* Returns the value of the option at the index, either attached to the option
+   itself or the following argument. Moves the index to the last argument used.
+   Returns an empty string if the value is missing */
+static string optionValue(int argc, char* argv[], int& argIndex)
+{
+  if (argv[argIndex][2] != '\0')
+    return string(argv[argIndex] + 2);
+  else if ((argIndex + 1) < argc)
+    return string(argv[++argIndex]);
+  else
+    return string();
+}
+
+/* Converts text holding only digits to a number no larger than the maximum.
+   Returns false if the text is anything else */
+static bool parseCount(const string& text, unsigned long maxValue, unsigned long& value)
+{
+  if (text.empty() || (text.find_first_not_of("0123456789") != string::npos) ||
+      (text.length() > 9))
+    return false;
+  value = strtoul(text.c_str(), NULL, 10);
+  return (value <= maxValue);
+}
+
+/* Converts text to a number that is not negative, with empty text giving zero.
+   Returns false if it is anything else */
+static bool parseSpeed(const string& text, double& value)
+{
+  char* end;
+  value = 0.0;
+  if (text.empty())
+    return true;
+  value = strtod(text.c_str(), &end);
+  return ((*end == '\0') && (value >= 0.0));
+}
+
+/* Adds the file names listed in the input, one per line, to the list. Blank
+   lines are skipped */
+static void readFileList(istream& input, vector<string>& fileNames)
+{
+  string line;
+  while (getline(input, line)) {
+    // Lists written on Windows end each line with a carriage return
+    if ((!line.empty()) && (line[line.length() - 1] == '\r'))
+      line.erase(line.length() - 1);
+    if (!line.empty())
+      fileNames.push_back(line);
+  }
+}
+
 int main(int argc, char* argv[])
 {
-  string fileName;
-  int fileIndex;
+  vector<string> fileNames;
+  int argIndex;
+  unsigned int fileIndex;
+  int threadCount = 1;
+  string cacheDirectory; // Empty if no cache is used
+  unsigned long maxInMemory = 0; // Functions held in memory for sorting, zero for no limit
+  unsigned long benchmarkSize = 0; // Size of benchmark file in KB, zero for no benchmark
+  const unsigned long maxBenchmarkSize = 1048576; // 1 GB, the file is built in memory
+  BenchmarkShape benchmarkShape;
+  double benchmarkSpeed = 0.0; // Slowest speed the benchmark allows in MB/s, zero for no limit
+  bool showStats = false; // True, output statistics for each file
+  bool serverMode = false; // True, keep the index up to date and answer queries
+  bool pipelined = false; // True, read and lex each file on separate threads
+  bool linkFiles = false; // True, check functions across all the files
+  string graphOutput; // File to write the call graph to, if any
+  vector<string> fileLists; // Files listing more files to process, - for standard input
+  unsigned int prefetchCount = 0; // Files to read ahead of the indexer, zero for none
+  string diagnosticOutput; // File to write warnings to, instead of the usual stream
+  vector<string> warningLimits; // Kinds of warnings to limit, each with its limit
+  FunctionWriter::Format outputFormat = FunctionWriter::tableFormat; // How to write the results
+  DiagnosticSink diagnostics;
+  ofstream diagnosticFile;
+  RegionFilter filter; // Source files to index
+  const RegionFilter* usedFilter = NULL; // NULL if every source file is indexed
+  HeaderCache headerCache(filter); // What excluded header text declares
+  HeaderCache* usedHeaderCache = NULL; // NULL if nothing is excluded
+  string binaryOutput; // Binary index file to write instead of the table, if any
+  string binaryInput; // Binary index file to read instead of indexing, if any
+  IndexStats totalStats;
   FuncDataVect functData;
   FuncDataVect::const_iterator functIndex;
+  FunctionData nextFunct(InternedString(), FilePosition(InternedString(), 0),
+                         false, InternedString(), false, false);
   FunctFinder inputData;
+  string trailer; // Warnings from the last file, output after the results
+  ostringstream optionMessages; // Problems with the options, output once the format is known
 
-  cout << endl;
-  fileIndex = 1;
-  if (argc <= 1)
-    cout << "Must specify at least one file to process" << endl;
+  totalStats.clear();
+  // Options come before the file names
+  argIndex = 1;
+  while ((argIndex < argc) && (argv[argIndex][0] == '-')) {
+    if (strcmp(argv[argIndex], "--stats") == 0) {
+      showStats = true;
+      if (!haveIndexStats())
+        optionMessages << "Statistics are not collected by this build. Rebuild with INDEX_STATS defined to get them"
+                       << endl;
+    }
+    else if (strncmp(argv[argIndex], "-j", 2) == 0)
+      threadCount = atoi(optionValue(argc, argv, argIndex).c_str());
+    else if (strncmp(argv[argIndex], "-c", 2) == 0)
+      cacheDirectory = optionValue(argc, argv, argIndex);
+    else if (strncmp(argv[argIndex], "-m", 2) == 0)
+      maxInMemory = strtoul(optionValue(argc, argv, argIndex).c_str(), NULL, 10);
+    else if (strcmp(argv[argIndex], "-w") == 0)
+      serverMode = true;
+    else if (strcmp(argv[argIndex], "-p") == 0)
+      pipelined = true;
+    else if (strcmp(argv[argIndex], "-l") == 0)
+      linkFiles = true;
+    else if (strncmp(argv[argIndex], "-o", 2) == 0)
+      binaryOutput = optionValue(argc, argv, argIndex);
+    else if (strncmp(argv[argIndex], "-x", 2) == 0)
+      filter.exclude(optionValue(argc, argv, argIndex));
+    else if (strncmp(argv[argIndex], "-i", 2) == 0)
+      filter.include(optionValue(argc, argv, argIndex));
+    else if (strncmp(argv[argIndex], "-f", 2) == 0)
+      fileLists.push_back(optionValue(argc, argv, argIndex));
+    else if (strncmp(argv[argIndex], "-a", 2) == 0)
+      prefetchCount = strtoul(optionValue(argc, argv, argIndex).c_str(), NULL, 10);
+    else if (strncmp(argv[argIndex], "-d", 2) == 0)
+      diagnosticOutput = optionValue(argc, argv, argIndex);
+    else if (strncmp(argv[argIndex], "-q", 2) == 0)
+      warningLimits.push_back(optionValue(argc, argv, argIndex));
+    else if (strncmp(argv[argIndex], "-t", 2) == 0) {
+      string value = optionValue(argc, argv, argIndex);
+      if (!FunctionWriter::findFormat(value, outputFormat))
+        optionMessages << "Unknown output format " << value << " ignored" << endl;
+    }
+    else if (strncmp(argv[argIndex], "-g", 2) == 0)
+      graphOutput = optionValue(argc, argv, argIndex);
+    else if (strncmp(argv[argIndex], "-r", 2) == 0)
+      binaryInput = optionValue(argc, argv, argIndex);
+    else if (strncmp(argv[argIndex], "-b", 2) == 0) {
+      /* Size, optionally followed by a comma and the shape name, and then
+         another comma and the minimum speed */
+      string value = optionValue(argc, argv, argIndex);
+      string::size_type comma = value.find(',');
+      string shape = (comma != string::npos) ? value.substr(comma + 1) : string();
+      string::size_type speedComma = shape.find(',');
+      if ((!parseCount(value.substr(0, comma), maxBenchmarkSize, benchmarkSize)) ||
+          (benchmarkSize == 0)) {
+        cout << "Benchmark size " << value.substr(0, comma) << " must be a number of KB from 1 to "
+             << maxBenchmarkSize << endl;
+        return 1;
+      }
+      if (speedComma != string::npos) {
+        if (!parseSpeed(shape.substr(speedComma + 1), benchmarkSpeed)) {
+          cout << "Benchmark speed " << shape.substr(speedComma + 1)
+               << " must be a number of MB/s, zero or more" << endl;
+          return 1;
+        }
+        shape.erase(speedComma);
+      }
+      if (!benchmarkShape.setShape(shape))
+        optionMessages << "Unknown benchmark shape " << shape << " ignored" << endl;
+    }
+    else
+      optionMessages << "Unknown option " << argv[argIndex] << " ignored" << endl;
+    argIndex++;
+  }
+  /* Records for other programs must not have anything else mixed in, so
+     everything else goes to standard error */
+  ostream& messages = (outputFormat == FunctionWriter::tableFormat) ? cout : cerr;
+  messages << optionMessages.str();
+  // Records for other programs start on the first line
+  if (outputFormat == FunctionWriter::tableFormat)
+    cout << endl;
+  while (argIndex < argc) {
+    fileNames.push_back(argv[argIndex]);
+    argIndex++;
+  }
+  // Lists avoid the limit on the length of the command line
+  for (argIndex = 0; argIndex < (int)fileLists.size(); argIndex++)
+    if (fileLists[argIndex] == "-")
+      readFileList(cin, fileNames);
+    else {
+      ifstream list(fileLists[argIndex].c_str());
+      if (!list.is_open())
+        messages << "Could not read file list " << fileLists[argIndex] << endl;
+      else
+        readFileList(list, fileNames);
+    }
+  // Warnings normally go with the rest of the output
+  if (serverMode || (outputFormat != FunctionWriter::tableFormat))
+    diagnostics.setOutput(cerr);
+  if (!diagnosticOutput.empty()) {
+    // The format comes from the file extension, plain text if it's not known
+    string::size_type dot = diagnosticOutput.rfind('.');
+    string extension = (dot != string::npos) ? diagnosticOutput.substr(dot) : string();
+    diagnosticFile.open(diagnosticOutput.c_str());
+    if (!diagnosticFile.is_open())
+      messages << "Could not write warnings to " << diagnosticOutput << endl;
+    else {
+      diagnostics.setOutput(diagnosticFile);
+      if (extension == ".json")
+        diagnostics.setFormat(DiagnosticSink::jsonFormat);
+      else if (extension == ".sarif")
+        diagnostics.setFormat(DiagnosticSink::sarifFormat);
+    }
+  }
+  // Each limit is a kind of warning, optionally followed by = and a count
+  for (argIndex = 0; argIndex < (int)warningLimits.size(); argIndex++) {
+    string::size_type equals = warningLimits[argIndex].find('=');
+    string codeName = warningLimits[argIndex].substr(0, equals);
+    WarningCode code = findWarningCode(codeName);
+    if (code == WarningCodeCount)
+      messages << "Unknown kind of warning " << codeName << " ignored" << endl;
+    else if (equals == string::npos)
+      diagnostics.setLimit(code, 0);
+    else
+      diagnostics.setLimit(code, strtoul(warningLimits[argIndex].substr(equals + 1).c_str(),
+                                         NULL, 10));
+  }
+
+  if (!filter.empty()) {
+    usedFilter = &filter;
+    usedHeaderCache = &headerCache;
+  }
+
+  if (benchmarkSize > 0) {
+    IndexBenchmark benchmark(benchmarkShape);
+    benchmark.setMinSpeed(benchmarkSpeed);
+    // Fail the run, so scripts checking for regressions can tell
+    if (!benchmark.run(benchmarkSize, cout))
+      return 1;
+  }
+  else if (!binaryInput.empty()) {
+    // The remaining arguments are names of functions to look up
+    BinaryIndexReader reader;
+    unsigned int first;
+    unsigned int count;
+    if (!reader.open(binaryInput))
+      messages << "Could not read index file " << binaryInput << endl;
+    else if (fileNames.empty()) {
+      if ((reader.getFunctionCount() == 0) && (outputFormat == FunctionWriter::tableFormat))
+        cout << "No functions were found!" << endl;
+      else {
+        FunctionWriter writer(cout, outputFormat);
+        writer.writeHeadings();
+        for (fileIndex = 0; fileIndex < reader.getFunctionCount(); fileIndex++)
+          writer.add(reader.getFunction(fileIndex));
+      }
+    }
+    else {
+      FunctionWriter writer(cout, outputFormat);
+      for (argIndex = 0; argIndex < (int)fileNames.size(); argIndex++) {
+        if (!reader.findName(fileNames[argIndex], first, count)) {
+          writer.flush(); // Keep the message in order with the rows
+          messages << "No functions named " << fileNames[argIndex] << " were found" << endl;
+        }
+        else
+          for (; count > 0; count--, first++)
+            writer.add(reader.getFunction(first));
+      }
+    }
+  }
+  else if (fileNames.empty())
+    messages << "Must specify at least one file to process" << endl;
+  else if (serverMode) {
+    IndexCache cache(cacheDirectory);
+    IndexServer server(fileNames, diagnostics);
+    if (!cacheDirectory.empty())
+      server.setCache(&cache);
+    if (usedFilter != NULL)
+      cache.setVariant(filter.describe());
+    server.setFilter(usedFilter);
+    server.setHeaderCache(usedHeaderCache);
+    server.load((threadCount > 1) ? threadCount : 1);
+    server.run(cin, cout);
+    diagnostics.finish();
+  }
   else {
-    while (fileIndex < argc) {
-      try {
-        fileName = argv[fileIndex];
-        inputData.start(fileName);
-        while (!inputData.haveEOF())
-            functData.push_back(inputData.nextFunction());
+    FunctionSorter sorter(maxInMemory, (threadCount > 1) ? threadCount : 1);
+    FunctionLinker linker;
+    CallGraph graph;
+    FilePrefetcher prefetcher(fileNames, prefetchCount);
+    if (prefetchCount > 0)
+      prefetcher.start();
+    inputData.setPipelined(pipelined);
+    inputData.setFilter(usedFilter);
+    inputData.setHeaderCache(usedHeaderCache);
+    if ((threadCount <= 1) && cacheDirectory.empty())
+      for (fileIndex = 0; fileIndex < fileNames.size(); fileIndex++) {
+        prefetcher.advance(fileIndex);
+        ostringstream fileLog;
+        inputData.setLog(fileLog);
+        indexFile(inputData, fileNames[fileIndex], functData, fileLog);
+        diagnostics.write(fileLog.str());
+        if (showStats) {
+          IndexStats::_current.write(cerr, fileNames[fileIndex]);
+          totalStats.add(IndexStats::_current);
+        }
+        if (linkFiles)
+          linker.addFile(functData);
+        for (functIndex = functData.begin(); functIndex != functData.end();
+             functIndex++) {
+          sorter.add(*functIndex);
+          if (!graphOutput.empty())
+            graph.add(*functIndex);
+        }
+        functData.clear();
       }
-      catch (exception& error) {
-        cout << "Processing file " << fileName << " stopped early due to error: "
-             << error.what() << endl;
+    else {
+      IndexCache cache(cacheDirectory);
+      IndexPool workers(fileNames);
+      if (!cacheDirectory.empty())
+        workers.setCache(&cache);
+      workers.setPipelined(pipelined);
+      workers.setFilter(usedFilter);
+      workers.setHeaderCache(usedHeaderCache);
+      if (prefetchCount > 0)
+        workers.setPrefetcher(&prefetcher);
+      if (usedFilter != NULL)
+        cache.setVariant(filter.describe());
+      if (linkFiles)
+        workers.setLinker(&linker);
+      if (threadCount < 1)
+        threadCount = 1;
+      workers.start(threadCount);
+      /* Output warnings in file order. The warnings reported after a file
+         is processed are output when the next one starts, so the last file's
+         warnings come after the results, when inputData is destroyed in a
+         single threaded run. Each result is released once used, so workers
+         never get too far ahead of the output */
+      for (fileIndex = 0; fileIndex < fileNames.size(); fileIndex++) {
+        const FileResult& result = workers.waitForResult(fileIndex);
+        diagnostics.write(result.log);
+        if ((fileIndex + 1) < fileNames.size())
+          diagnostics.write(result.trailer);
+        else
+          trailer = result.trailer;
+        if (showStats) {
+          result.stats.write(cerr, fileNames[fileIndex]);
+          totalStats.add(result.stats);
+        }
+        for (functIndex = result.functions.begin();
+             functIndex != result.functions.end(); functIndex++) {
+          sorter.add(*functIndex);
+          if (!graphOutput.empty())
+            graph.add(*functIndex);
+        }
+        workers.releaseResult(fileIndex);
       }
-      fileIndex++;
+    }
+    if ((threadCount <= 1) && cacheDirectory.empty()) {
+      /* Some warnings are only issued once the last file is done. They come
+         after the results, as in a multithreaded run */
+      ostringstream lastLog;
+      inputData.setLog(lastLog);
+      inputData.finish();
+      trailer = lastLog.str();
+      inputData.setLog(cout); // Log stream above is gone
+    }
+    // Problems between files come after all the problems within them
+    if (linkFiles) {
+      ostringstream linkLog;
+      linker.link(linkLog, (threadCount > 1) ? threadCount : 1);
+      diagnostics.write(linkLog.str());
     }
     // Output the results
-    if (functData.empty())
+    if (!binaryOutput.empty()) {
+      BinaryIndexWriter writer;
+      if (!sorter.empty()) {
+        sorter.startOutput();
+        while (sorter.nextFunction(nextFunct))
+          writer.add(nextFunct);
+      }
+      if (!writer.write(binaryOutput))
+        messages << "Could not write index file " << binaryOutput << endl;
+    }
+    else if (sorter.empty() && (outputFormat == FunctionWriter::tableFormat))
       cout << "No functions were found!" << endl;
     else {
-      std::sort(functData.begin(), functData.end());
-      cout << "Function name         scope               caller                source          line"
-           << endl;
-      for (functIndex = functData.begin(); functIndex != functData.end();
-        functIndex++)
-      cout << *functIndex;
+      // Rows are written as they come out of the sort
+      FunctionWriter writer(cout, outputFormat);
+      sorter.startOutput();
+      writer.writeHeadings();
+      while (sorter.nextFunction(nextFunct))
+        writer.add(nextFunct);
+    }
+    if (sorter.spillFailed())
+      cerr << "Could not write temporary sort files, sorted in memory instead" << endl;
+    if (sorter.readFailed()) {
+      cout.flush(); // Keep the message after the rows written
+      cerr << "Could not read temporary sort files, the output is incomplete" << endl;
+      return 1;
+    }
+    if (!graphOutput.empty()) {
+      // The format comes from the file extension, binary if it's not known
+      bool written;
+      graph.build();
+      string::size_type dot = graphOutput.rfind('.');
+      string extension = (dot != string::npos) ? graphOutput.substr(dot) : string();
+      if ((extension == ".dot") || (extension == ".json")) {
+        ofstream output(graphOutput.c_str());
+        if (extension == ".dot")
+          graph.writeDot(output);
+        else
+          graph.writeJson(output);
+        output.close();
+        written = (bool)output;
+      }
+      else
+        written = graph.writeBinary(graphOutput);
+      if (!written)
+        messages << "Could not write call graph file " << graphOutput << endl;
     }
+    diagnostics.write(trailer);
+    diagnostics.finish();
+    if (showStats)
+      totalStats.write(cerr, "all files");
   }
 }
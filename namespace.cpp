@@ -24,9 +24,12 @@
 
 #include <iostream>
 #include <string>
+#include <chrono>
 #include <vector>
-#include <set>
+#include <algorithm>
+#include <cstring>
 #include "basetypes.h"
+#include "indexstats.h"
 #include "errors.h"
 #include "namespace.h"
 
@@ -35,20 +38,174 @@ using std::string;
 using std::ostream;
 using std::cout;
 using std::endl;
-using std::set;
+using std::memcmp;
 
-// Prints out the token set. Main use is debugging
-ostream& operator<<(ostream& stream, const TokenSet& testval)
+// Description of a C keyword
+struct KeywordData {
+  const char* text;
+  unsigned int length;
+  Token::TokenType type;
+  Token::ModType modifier;
+};
+
+enum { _KeywordSlots = 64 };
+
+/* Hash function for the keyword table. It is a perfect hash of the C
+   keywords, so every keyword has its own slot and a lookup needs only one
+   comparison. Found by searching combinations of the length, first char, and
+   last char of the keywords */
+static constexpr unsigned int keywordHash(const char* text, unsigned int length)
+{
+  return (((5 * length) + (14 * (unsigned char)text[0]) +
+           (5 * (unsigned char)text[length - 1])) & (_KeywordSlots - 1));
+}
+
+// The default C keywords, each in the slot given by its hash
+static constexpr KeywordData _keywords[_KeywordSlots] = {
+  { "return", 6, Token::reserved, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "unsigned", 8, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "if", 2, Token::control, Token::onearg },
+  { "const", 5, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "extern", 6, Token::typetoken, Token::nomod },
+  { "continue", 8, Token::reserved, Token::nomod },
+  { "break", 5, Token::reserved, Token::nomod },
+  { "auto", 4, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "double", 6, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "int", 3, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "else", 4, Token::reserved, Token::nomod },
+  { "while", 5, Token::control, Token::onearg },
+  { "volatile", 8, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "static", 6, Token::statictoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "signed", 6, Token::typetoken, Token::nomod },
+  { "for", 3, Token::control, Token::threearg },
+  { "register", 8, Token::typetoken, Token::nomod },
+  { "default", 7, Token::reserved, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "goto", 4, Token::reserved, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "union", 5, Token::compound, Token::nomod },
+  { "sizeof", 6, Token::literal, Token::nomod }, // Close enough
+  { "short", 5, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "struct", 6, Token::compound, Token::nomod },
+  { "do", 2, Token::reserved, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "switch", 6, Token::control, Token::onearg },
+  { "float", 5, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "case", 4, Token::reserved, Token::nomod },
+  { "char", 4, Token::typetoken, Token::nomod },
+  { "typedef", 7, Token::typedeftoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "enum", 4, Token::compound, Token::nomod },
+  { "void", 4, Token::typetoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { NULL, 0, Token::notoken, Token::nomod },
+  { "long", 4, Token::typetoken, Token::nomod },
+};
+
+// Checks that every keyword is in the slot its hash gives
+static constexpr bool keywordSlotsValid(unsigned int slot)
 {
-  TokenSet::const_iterator index;
-  for (index = testval.begin(); index != testval.end(); index++)
+  return ((slot >= _KeywordSlots) ||
+          (((_keywords[slot].text == NULL) ||
+            (keywordHash(_keywords[slot].text, _keywords[slot].length) == slot)) &&
+           keywordSlotsValid(slot + 1)));
+}
+
+static_assert(keywordSlotsValid(0), "Keyword table does not match its hash function");
+
+TokenTable::TokenTable()
+    : _slots(16), _slotUsed(16, false), _mask(15)
+{
+}
+
+// Doubles the number of slots
+void TokenTable::grow()
+{
+  vector<Token> oldSlots(_slots.size() * 2);
+  vector<unsigned int> oldUsedSlots;
+  unsigned int index;
+
+  oldSlots.swap(_slots);
+  oldUsedSlots.swap(_usedSlots);
+  _slotUsed.assign(_slots.size(), false);
+  _mask = _slots.size() - 1;
+  for (index = 0; index < oldUsedSlots.size(); index++)
+    insert(oldSlots[oldUsedSlots[index]]);
+}
+
+// Adds a token, unless one with the same lexeme already exists
+void TokenTable::insert(const Token& token)
+{
+  unsigned int slot = findSlot(token);
+  if (!_slotUsed[slot]) {
+    // Keep the table at most half full, so searches stay short
+    if (((_usedSlots.size() + 1) * 2) > _slots.size()) {
+      grow();
+      slot = findSlot(token);
+    }
+    _slots[slot] = token;
+    _slotUsed[slot] = true;
+    _usedSlots.push_back(slot);
+  }
+}
+
+void TokenTable::clear()
+{
+  unsigned int index;
+  for (index = 0; index < _usedSlots.size(); index++)
+    _slotUsed[_usedSlots[index]] = false;
+  _usedSlots.clear();
+}
+
+// Returns the tokens sorted by lexeme
+vector<Token> TokenTable::sorted() const
+{
+  vector<Token> result;
+  unsigned int index;
+  for (index = 0; index < _usedSlots.size(); index++)
+    result.push_back(_slots[_usedSlots[index]]);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Prints out the token table. Main use is debugging
+ostream& operator<<(ostream& stream, const TokenTable& testval)
+{
+  vector<Token> tokens = testval.sorted();
+  vector<Token>::const_iterator index;
+  for (index = tokens.begin(); index != tokens.end(); index++)
     stream << *index << endl;
   return stream;
 }
 
 ostream& operator<<(ostream& stream, const NameSpace& value)
 {
-  TokenSet::iterator index;
   stream << "Global symbols:" << endl;
   stream << value._globalList;
   stream << "Local symbols:" << endl;
@@ -58,40 +215,24 @@ ostream& operator<<(ostream& stream, const NameSpace& value)
 
 // Constructor
 NameSpace::NameSpace()
+    : _log(&cout)
+{
+  // The C keywords are in a fixed table, see above
+}
+
+// Returns the C keyword with the same lexeme as the token, or NULL if none
+const KeywordData* NameSpace::findKeyword(const Token& testToken)
 {
-  // Create the list of default C keywords.
-  _keyList.insert(Token("auto", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("break", Token::reserved, Token::nomod));
-  _keyList.insert(Token("case", Token::reserved, Token::nomod));
-  _keyList.insert(Token("char", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("const", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("continue", Token::reserved, Token::nomod));
-  _keyList.insert(Token("default", Token::reserved, Token::nomod));
-  _keyList.insert(Token("do", Token::reserved, Token::nomod));
-  _keyList.insert(Token("double", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("else", Token::reserved, Token::nomod));
-  _keyList.insert(Token("enum", Token::compound, Token::nomod));
-  _keyList.insert(Token("extern", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("float", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("for", Token::control, Token::threearg));
-  _keyList.insert(Token("goto", Token::reserved, Token::nomod));
-  _keyList.insert(Token("if", Token::control, Token::onearg));
-  _keyList.insert(Token("int", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("long", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("register", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("return", Token::reserved, Token::nomod));
-  _keyList.insert(Token("short", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("signed", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("sizeof", Token::literal, Token::nomod)); // Close enough
-  _keyList.insert(Token("static", Token::statictoken, Token::nomod));
-  _keyList.insert(Token("struct", Token::compound, Token::nomod));
-  _keyList.insert(Token("switch", Token::control, Token::onearg));
-  _keyList.insert(Token("typedef", Token::typedeftoken, Token::nomod));
-  _keyList.insert(Token("union", Token::compound, Token::nomod));
-  _keyList.insert(Token("unsigned", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("void", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("volatile", Token::typetoken, Token::nomod));
-  _keyList.insert(Token("while", Token::control, Token::onearg));
+  const string& lexeme = testToken.getLexeme();
+  if (lexeme.empty())
+    return NULL;
+  const KeywordData& keyword = _keywords[keywordHash(lexeme.data(), lexeme.length())];
+  // Empty slots have length zero, so never match
+  if ((keyword.length == lexeme.length()) &&
+      (memcmp(keyword.text, lexeme.data(), keyword.length) == 0))
+    return &keyword;
+  else
+    return NULL;
 }
 
 // Destructor
@@ -108,27 +249,36 @@ void NameSpace::clearGlobalNames()
   clearLocalNames();
   /* A static prototype without a matching function declaration is an
      error. If find one here, it was never matched by a declaration */
-  TokenSet::iterator index;
-  for (index = _globalList.begin(); index != _globalList.end(); index++)
-    if ((index->getType() == Token::functproto) &&
-        (index->getScope() == Token::filescope))
-        logTokenError(cout, *index, "Static prototype of ",
-                      " has no matching declaration");
-  _globalList.clear();
+  if (!_globalList.empty()) {
+    // Report in lexeme order, so the output does not depend on the table layout
+    vector<Token> symbols = _globalList.sorted();
+    vector<Token>::const_iterator index;
+    for (index = symbols.begin(); index != symbols.end(); index++)
+      if ((index->getType() == Token::functproto) &&
+          (index->getScope() == Token::filescope))
+          logTokenError(*_log, unmatchedPrototype, *index, "Static prototype of ",
+                        " has no matching declaration");
+    _globalList.clear();
+  }
 }
 
 // If the token is a keyword, changes token data to that of the keyword
 void NameSpace::checkForSymbol(Token& testToken)
 {
-  TokenSet::iterator symbolIter;
+  const Token* symbolIter;
   bool localVar = false; // True, name is a variable in local scope
+  STATS_TIMER(symbolStage);
+  STATS_COUNT(lookups, 1);
 
-  symbolIter = _keyList.find(testToken);
-  if (symbolIter != _keyList.end()) // Identifier is a reserved word
-    testToken.setToTokenMeaning(*symbolIter);
+  const KeywordData* keyword = findKeyword(testToken);
+  if (keyword != NULL) { // Identifier is a reserved word
+    testToken.setType(keyword->type);
+    testToken.setScope(Token::keyword);
+    testToken.setModifier(keyword->modifier);
+  }
   else { // Check for local symbol
     symbolIter = _localList.find(testToken);
-    if (symbolIter != _localList.end()) {
+    if (symbolIter != NULL) {
       if (symbolIter->getType() == Token::typetoken) // Locally defined typedef
         testToken.setToTokenMeaning(*symbolIter);
       else
@@ -138,9 +288,9 @@ void NameSpace::checkForSymbol(Token& testToken)
        function call, it is an error. This program is biased toward believing
        a function call was intended in such cases, so get scope info even if
        the name is a local variable */
-    if ((symbolIter == _localList.end()) || localVar) {
+    if ((symbolIter == NULL) || localVar) {
       symbolIter = _globalList.find(testToken);
-      if (symbolIter == _globalList.end())
+      if (symbolIter == NULL)
         testToken.setScope(Token::noscope); // Can't determine its scope yet
       // Check for defined typedef. Need to check if it is shadowed
       else if (haveTypeToken(*symbolIter)) {
@@ -170,25 +320,20 @@ bool NameSpace::isKeyword(const Token& testToken)
      identifier, need to look it up to find out what it really is. For
      everything else, base the result on the token type */
   if (testToken.getType() != Token::identifier)
-    return ((testToken.getType() == Token::literal) || (testToken.getType() == Token::functdecl) ||
-            (testToken.getType() == Token::functproto) || (testToken.getType() == Token::functcall) ||
-            (testToken.getType() == Token::functtypedef) || (testToken.getType() == Token::typetoken) ||
-            (testToken.getType() == Token::typedeftoken) || (testToken.getType() == Token::statictoken) ||
-            (testToken.getType() == Token::compound) || (testToken.getType() == Token::control) ||
-            (testToken.getType() == Token::reserved));
+    return testToken.isTypeIn(_KeywordTypes);
   else {
     // Identifier, so need to look it up in symbol table. Its a keyword if its not a variable name
-    TokenSet::iterator temp;
-    temp = _keyList.find(testToken);
-    if ((temp != _keyList.end()) && (temp->getType() != Token::varname))
+    const Token* temp;
+    // Keywords are never variable names
+    if (findKeyword(testToken) != NULL)
         return true;
     else {
         temp = _globalList.find(testToken);
-        if ((temp != _globalList.end()) && (temp->getType() != Token::varname))
+        if ((temp != NULL) && (temp->getType() != Token::varname))
             return true;
         else {
             temp = _localList.find(testToken);
-            return ((temp != _localList.end()) &&
+            return ((temp != NULL) &&
                     (temp->getType() != Token::varname));
         } // Not in global symbol list
     } // Not in language keyword list
@@ -199,8 +344,8 @@ bool NameSpace::isKeyword(const Token& testToken)
    of symbol collisions which can affect the program results. */
 void NameSpace::updateNameSpace(const Token& testToken)
 {
-  TokenSet::iterator globalIter; // Pointer to existing global record
-  TokenSet::iterator localiter; // Pointer to existing local record
+  Token* globalIter; // Pointer to existing global record
+  Token* localiter; // Pointer to existing local record
 
   globalIter = _globalList.find(testToken);
   localiter = _localList.find(testToken);
@@ -208,7 +353,7 @@ void NameSpace::updateNameSpace(const Token& testToken)
   if (testToken.getScope() == Token::localscope) { // Local scope
     /* Local scope is updated if the symbol is new, or a typedef collided
        with a varname */
-    if ((localiter == _localList.end()) ||
+    if ((localiter == NULL) ||
         ((localiter->getType() == Token::varname) &&
          (testToken.getType() == Token::typetoken))) {
       /* If the symbol collides with a global symbol, a shadow situation now
@@ -216,161 +361,159 @@ void NameSpace::updateNameSpace(const Token& testToken)
          Shadowing by type is more serious than shadowing by a variable,
          because it is much harder to check if a type symbol was meant to be
          used as a function */
-      if ((globalIter != _globalList.end()) && (!haveVarToken(*globalIter))) {
+      if ((globalIter != NULL) && (!haveVarToken(*globalIter))) {
         if (testToken.getType() == Token::typetoken) {
             if (globalIter->getType() == Token::functtypedef)
-                logTokenError(cout, testToken, "Declaration of type ",
+                logTokenError(*_log, shadowedName, testToken, "Declaration of type ",
                               " shadows function typedef with same name in outer scope");
             else
-                logTokenError(cout, testToken, "Declaration of type ",
+                logTokenError(*_log, shadowedName, testToken, "Declaration of type ",
                               " shadows function with same name in outer scope");
         }
         else if (globalIter->getType() == Token::functtypedef)
-            logTokenError(cout, testToken, "Local variable ",
+            logTokenError(*_log, shadowedName, testToken, "Local variable ",
                           " shadows function typedef with same name in outer scope");
         else
-            logTokenError(cout, testToken, "Local variable ",
+            logTokenError(*_log, shadowedName, testToken, "Local variable ",
                           " shadows function with same name in outer scope");
       }
-      if (localiter != _localList.end())
-        _localList.erase(localiter);
-      _localList.insert(testToken);
+      if (localiter != NULL)
+        *localiter = testToken;
+      else
+        _localList.insert(testToken);
     } // Need to update local scope
   }
   // Symbol must be file or global scope
   else if (haveVarToken(testToken)) {
-    if (globalIter == _globalList.end())
+    if (globalIter == NULL)
       _globalList.insert(testToken);
     // Report colision of a var with a function
     else if (!haveVarToken(*globalIter)) {
       if (globalIter->getType() == Token::functtypedef) {
         if (testToken.getType() == Token::varname)
-            logTokenError(cout, testToken, "Variable ",
+            logTokenError(*_log, reusedName, testToken, "Variable ",
                           " uses name previosly used as typedef for function");
         else
-            logTokenError(cout, testToken, "Type declarion ",
+            logTokenError(*_log, reusedName, testToken, "Type declarion ",
                           " uses name previosly used as typedef for function");
       }
       else if (testToken.getType() == Token::varname)
-        logTokenError(cout, testToken, "Variable ",
+        logTokenError(*_log, reusedName, testToken, "Variable ",
                       " uses name previously used as a function");
       else
-        logTokenError(cout, testToken, "Type declaration ",
+        logTokenError(*_log, reusedName, testToken, "Type declaration ",
                       " uses name previously used as a function");
     }
     // If a var collides with a typedef, take the typedef
     else if ((globalIter->getType() == Token::varname) &&
              (testToken.getType() == Token::typetoken)) {
-      _globalList.erase(globalIter);
-      _globalList.insert(testToken);
+      *globalIter = testToken; // Replace the existing symbol
     }
   }
   else { // Function typedef or function
-    if (localiter != _localList.end()) {
+    if (localiter != NULL) {
       // Collision with a local name
       /* If have either a function call that was not previously declared, or a
          type that was ignored due to a shadow, assume the conflict is due
          to the misuse of the local symbol */
-      if (((globalIter != _globalList.end()) && haveTypeToken(*globalIter)) ||
+      if (((globalIter != NULL) && haveTypeToken(*globalIter)) ||
           ((testToken.getType() == Token::functcall) &&
-           ((globalIter == _globalList.end()) || haveVarToken(*globalIter)))) {
+           ((globalIter == NULL) || haveVarToken(*globalIter)))) {
         if (testToken.getType() == Token::functtypedef)
-            logTokenError(cout, testToken, "Typedef for function ",
+            logTokenError(*_log, reusedName, testToken, "Typedef for function ",
                           " uses name previously used as a local variable");
         else
-            logTokenError(cout, testToken, "Function ",
+            logTokenError(*_log, reusedName, testToken, "Function ",
                           " uses name previously used as a local variable");
       }
       // Collision is a shadow. Issue a warning if the shadow is new
-      else if ((globalIter == _globalList.end()) ||
+      else if ((globalIter == NULL) ||
                haveVarToken(*globalIter)) {
         if (localiter->getType() == Token::typetoken) {
             if (testToken.getType() == Token::functtypedef)
-                logTokenError(cout, testToken, "Declaration of type ",
+                logTokenError(*_log, shadowedName, testToken, "Declaration of type ",
                               " shadows function typedef with same name in outer scope");
             else
-                logTokenError(cout, testToken, "Declaration of type ",
+                logTokenError(*_log, shadowedName, testToken, "Declaration of type ",
                               " shadows function with same name in outer scope");
         }
         else if (testToken.getType() == Token::functtypedef)
-            logTokenError(cout, *localiter, "Local variable ",
+            logTokenError(*_log, shadowedName, *localiter, "Local variable ",
                           " shadows function typedef with same name in outer scope");
         else
-            logTokenError(cout, *localiter, "Local variable ",
+            logTokenError(*_log, shadowedName, *localiter, "Local variable ",
                           " shadows function with same name in outer scope");
         }
     }
     if (testToken.getType() == Token::functcall) {
       /* If function call collides with a type, ignore it. Issue a warning if
          the collision was not due to a local shadow */
-      if ((globalIter != _globalList.end()) && haveTypeToken(*globalIter)) {
-        if (localiter == _localList.end())
-            logTokenError(cout, *globalIter, "Type declaration ",
+      if ((globalIter != NULL) && haveTypeToken(*globalIter)) {
+        if (localiter == NULL)
+            logTokenError(*_log, reusedName, *globalIter, "Type declaration ",
                           " uses name previously used as a function");
       }
       /* If name of function is not in stack as a function prototype or
          declaration, have an undeclared function call. Issue a warning and
          update the namespace if the function call is not already there */
-      else if ((globalIter == _globalList.end()) ||
+      else if ((globalIter == NULL) ||
                ((globalIter->getType() != Token::functproto) &&
                 (globalIter->getType() != Token::functdecl))) {
-        logTokenError(cout, testToken, "Function call ",
+        logTokenError(*_log, missingPrototype, testToken, "Function call ",
                       " has no prototype");
-        if (globalIter == _globalList.end())
+        if (globalIter == NULL)
             _globalList.insert(testToken);
         else if (globalIter->getType() != Token::functcall) {
             // Compain if symbol was not shadowed
-            if (localiter == _localList.end())
-                logTokenError(cout, *globalIter, "Variable ",
+            if (localiter == NULL)
+                logTokenError(*_log, reusedName, *globalIter, "Variable ",
                               " uses name previously used as a function");
-            _globalList.erase(globalIter);
-            _globalList.insert(testToken);
+            *globalIter = testToken; // Replace the existing symbol
             }
         }
     } // Function call
     // Function prototype or declaration
-    else if (globalIter == _globalList.end())
+    else if (globalIter == NULL)
       _globalList.insert(testToken);
     /* If collide with a typedef, have a dedefiniton of a local variable,
        which shadowed the typedef, as a function declaration. This requies
        the function declaration to have been made in local scope, which is
        almost certainly an error. Lose the declaration */
     else if (haveTypeToken(*globalIter)) {
-      if (localiter == _localList.end()) { // Shadow handled above
+      if (localiter == NULL) { // Shadow handled above
         if (testToken.getType() == Token::functtypedef) {
             if (globalIter->getType() == Token::functtypedef)
-                logTokenError(cout, testToken, "Duplicate declaration of function typedef ", "");
+                logTokenError(*_log, duplicateDeclaration, testToken,
+                              "Duplicate declaration of function typedef ", "");
             else
-                logTokenError(cout, *globalIter, "Type declarion ",
+                logTokenError(*_log, reusedName, *globalIter, "Type declarion ",
                               " uses name previosly used as typedef for function");
         }
         else
-            logTokenError(cout, *globalIter, "Type declaration ",
+            logTokenError(*_log, reusedName, *globalIter, "Type declaration ",
                           " uses name previously used as a function");
       }
     }
     // If a function collides with a var, believe the function was intended
     else if (haveVarToken(*globalIter)) {
       if (testToken.getType() == Token::functtypedef)
-        logTokenError(cout, *globalIter, "Variable ",
+        logTokenError(*_log, reusedName, *globalIter, "Variable ",
                       " uses name previosly used as typedef for function");
       else
-        logTokenError(cout, *globalIter, "Variable ",
+        logTokenError(*_log, reusedName, *globalIter, "Variable ",
                       " uses name previously used as a function");
       // Overwrite the variable symbol with the token
-      _globalList.erase(globalIter);
-      _globalList.insert(testToken);
+      *globalIter = testToken; // Replace the existing symbol
     }
     /* If function typedef collides with a function declaration, believe the
        function declaration was intended */
     else if (testToken.getType() == Token::functtypedef)
-        logTokenError(cout, testToken, "Type declaration ",
+        logTokenError(*_log, reusedName, testToken, "Type declaration ",
                       " uses name previously used as a function");
     /* If a function call collides with a declaration, have the declaration
        for a previously undeclared function */
     else if (globalIter->getType() == Token::functcall) {
-      _globalList.erase(globalIter);
-      _globalList.insert(testToken);
+      *globalIter = testToken; // Replace the existing symbol
     }
     /* If get to there, a function or prototype collided with another
        declaration or prototype. Now file vs. global scope needs to be
@@ -382,39 +525,36 @@ void NameSpace::updateNameSpace(const Token& testToken)
       if (globalIter->getType() == Token::functproto) {
         if ((testToken.getScope() == Token::filescope) &&
             (globalIter->getScope() == Token::globalscope)) {
-            logTokenError(cout, testToken, "Static function ",
+            logTokenError(*_log, staticAfterPrototype, testToken, "Static function ",
                           "occurs after global prototype in same file.");
-            _globalList.erase(globalIter);
-            _globalList.insert(testToken);
+            *globalIter = testToken; // Replace the existing symbol
         }
         else
-            logTokenError(cout, testToken, "Duplicate prototype of ", "");
+            logTokenError(*_log, duplicatePrototype, testToken, "Duplicate prototype of ", "");
       }
       else
         // Prototype collided with declaration
-        logTokenError(cout, testToken, "Prototype for ",
+        logTokenError(*_log, prototypeAfterDeclaration, testToken, "Prototype for ",
                       " occurs after declaration");
     }
     else if (globalIter->getType() == Token::functproto) {
       // Declaration collided with prototype
       if ((testToken.getScope() == Token::filescope) &&
           (globalIter->getScope() == Token::globalscope))
-        logTokenError(cout, testToken, "Static function ",
+        logTokenError(*_log, staticAfterPrototype, testToken, "Static function ",
                       "occurs after global prototype in same file.");
-      _globalList.erase(globalIter);
-      _globalList.insert(testToken);
+      *globalIter = testToken; // Replace the existing symbol
     }
     // Declaration collided with declaration
     else {
       if (testToken.getScope() == globalIter->getScope())
-        logTokenError(cout, testToken, "Duplicate declaration of ", "");
+        logTokenError(*_log, duplicateDeclaration, testToken, "Duplicate declaration of ", "");
       else {
-        logTokenError(cout, testToken, "Duplicate declaration of ",
+        logTokenError(*_log, duplicateDeclaration, testToken, "Duplicate declaration of ",
                       ", with different scope. File scope assumed.");
         // Assume file scope is the one wanted for calls in the file
         if (globalIter->getScope() == Token::globalscope) {
-            _globalList.erase(globalIter);
-            _globalList.insert(testToken);
+            *globalIter = testToken; // Replace the existing symbol
         }
       }
     } // Function or typedef of function
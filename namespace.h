@@ -20,12 +20,48 @@
     updates. Please contact me through LinkedIn or github (my profile also has
     a link to the code depository)
 */
-using std::set;
+/* Group of tokens in namespace. Lexemes are interned, so tokens are found by
+   hashing the address of their text. Collisions are handled by checking the
+   following slots (open addressing). Tokens are only ever replaced, never
+   removed one at a time, so no deleted slot markers are needed */
+class TokenTable {
+ private:
+  vector<Token> _slots;
+  vector<char> _slotUsed; // True, slot holds a token
+  vector<unsigned int> _usedSlots; // Slots holding tokens, so clearing is fast
+  unsigned int _mask; // Number of slots less one, slot count is a power of two
+
+  // Returns the slot holding the token, or the empty slot where it belongs
+  unsigned int findSlot(const Token& token) const;
+
+  // Doubles the number of slots
+  void grow();
+
+ public:
+  TokenTable();
+
+  // This object uses the default copy constructor, assignment operator, and destructor
+
+  // Returns the token with the same lexeme, or NULL if there is none
+  Token* find(const Token& token);
+  const Token* find(const Token& token) const;
 
-typedef set<Token> TokenSet; // Group of tokens in namespace
+  // Adds a token, unless one with the same lexeme already exists
+  void insert(const Token& token);
+
+  void clear();
+
+  bool empty() const;
+
+  // Returns the tokens sorted by lexeme
+  vector<Token> sorted() const;
+};
 
 // Output operator. Used mainly for debugging
-ostream& operator<<(ostream& stream, const TokenSet& value);
+ostream& operator<<(ostream& stream, const TokenTable& value);
+
+// Description of a C keyword. Defined with the keyword table
+struct KeywordData;
 
 // Namespace.h Declaration of the named symbol tables
 class NameSpace {
@@ -33,15 +69,33 @@ class NameSpace {
   friend ostream& operator<<(ostream& stream, const NameSpace& value);
 
  private:
-  TokenSet _keyList; // List of C keywords and what their token values are
-  TokenSet _globalList; // List of global/file scope symbols
-  TokenSet _localList; // List of local (function) scope symbols
+  TokenTable _globalList; // List of global/file scope symbols
+  TokenTable _localList; // List of local (function) scope symbols
+  ostream* _log; // Destination of warning messages
+
+  /* Returns the C keyword with the same lexeme as the token, or NULL if it is
+     not a keyword. Keywords never change, so they are a fixed table */
+  static const KeywordData* findKeyword(const Token& testToken);
+
+  // Token types related to variables, and those declaring user defined types
+  static constexpr Token::TypeSet _VarTypes =
+    Token::typeSet(Token::varname) | Token::typeSet(Token::typetoken);
+  static constexpr Token::TypeSet _TypeTypes =
+    Token::typeSet(Token::typetoken) | Token::typeSet(Token::functtypedef);
+  // Token types that are always keywords or user defined names
+  static constexpr Token::TypeSet _KeywordTypes =
+    Token::typeSet(Token::literal) | Token::typeSet(Token::functdecl) |
+    Token::typeSet(Token::functproto) | Token::typeSet(Token::functcall) |
+    Token::typeSet(Token::functtypedef) | Token::typeSet(Token::typetoken) |
+    Token::typeSet(Token::typedeftoken) | Token::typeSet(Token::statictoken) |
+    Token::typeSet(Token::compound) | Token::typeSet(Token::control) |
+    Token::typeSet(Token::reserved);
 
   // Returns true if token is related to variables
-  bool haveVarToken(const Token& testToken);
+  static bool haveVarToken(const Token& testToken);
 
   // Returns true if token is a declaration of a user defined type
-  bool haveTypeToken(const Token& testToken);
+  static bool haveTypeToken(const Token& testToken);
 
   // This object is part of the parser, which can't be copied
   NameSpace(const NameSpace& other);
@@ -54,6 +108,9 @@ class NameSpace {
   // Destructor
   ~NameSpace();
 
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
   // Clears all user defined tokens from the namespace
   void clearGlobalNames();
 
@@ -70,6 +127,46 @@ class NameSpace {
   void updateNameSpace(const Token& testToken);
 };
 
+// Returns the slot holding the token, or the empty slot where it belongs
+inline unsigned int TokenTable::findSlot(const Token& token) const
+{
+  // Never more than half full, so an empty slot always exists
+  unsigned int slot = token.getInternedLexeme().hash() & _mask;
+  while (_slotUsed[slot] && (!(_slots[slot] == token)))
+    slot = (slot + 1) & _mask;
+  return slot;
+}
+
+// Returns the token with the same lexeme, or NULL if there is none
+inline Token* TokenTable::find(const Token& token)
+{
+  unsigned int slot = findSlot(token);
+  if (_slotUsed[slot])
+    return &_slots[slot];
+  else
+    return NULL;
+}
+
+inline const Token* TokenTable::find(const Token& token) const
+{
+  unsigned int slot = findSlot(token);
+  if (_slotUsed[slot])
+    return &_slots[slot];
+  else
+    return NULL;
+}
+
+inline bool TokenTable::empty() const
+{
+  return _usedSlots.empty();
+}
+
+// Sets where warning messages are written
+inline void NameSpace::setLog(ostream& log)
+{
+    _log = &log;
+}
+
 // Clears the namespace of all keywords with function scope
 inline void NameSpace::clearLocalNames()
 {
@@ -79,14 +176,12 @@ inline void NameSpace::clearLocalNames()
 // Returns true if token is related to variables
 inline bool NameSpace::haveVarToken(const Token& testToken)
 {
-  return ((testToken.getType() == Token::varname) ||
-          (testToken.getType() == Token::typetoken));
+  return testToken.isTypeIn(_VarTypes);
 }
 
 // Returns true if token is a declaration of a user defined type
 inline bool NameSpace::haveTypeToken(const Token& testToken)
 {
-  return ((testToken.getType() == Token::typetoken) ||
-          (testToken.getType() == Token::functtypedef));
+  return testToken.isTypeIn(_TypeTypes);
 }
 
@@ -24,17 +24,25 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <chrono>
 #include <vector>
+#include <utility>
 #include <list>
 #include <set>
 #include <algorithm>
+#include <unordered_map>
+#include <mutex>
 #include "basetypes.h"
+#include "indexstats.h"
 #include "errors.h"
 #include "filebuffer.h"
 #include "tokenizer.h"
 #include "namespace.h"
 #include "parser.h"
+#include "regionfilter.h"
+#include "headercache.h"
 
 using std::string;
 using std::vector;
@@ -103,6 +111,8 @@ Parser::SameType::SameType(const Token::TokenType& wantType)
 
   // Constructor
 Parser::Parser()
+    : _log(&cout), _filter(NULL), _regionExcluded(false), _noLog(NULL),
+      _headerCache(NULL)
 {
     init();
 }
@@ -159,9 +169,7 @@ void Parser::procCombType()
     braceCount = 1;
     parenCount = 0;
     while (_currToken.getType() == Token::compound) { // Still processing it
-      while ((next.getType() != Token::closebrace) && (next.getType() != Token::semicolon) &&
-             (next.getType() != Token::functcall) && (next.getType() != Token::control) &&
-             (next.getType() != Token::reserved) && (next.getType() != Token::tokenEOF)) {
+      while (!next.isTypeIn(_CompoundEnds)) {
         // Get next token in line
         if (readNext)
             next = _buffer.nextLookahead();
@@ -404,13 +412,13 @@ void Parser::procFunctDeclaration(Token& declToken, const Token& nextToken,
       ((declToken.getType() != Token::functdecl) &&
        (nextToken.getType() != Token::semicolon))) {
     if (declToken.getType() == Token::functtypedef)
-      logTokenError(cout, declToken, "Function type definition ",
+      logTokenError(*_log, incompleteDeclaration, declToken, "Function type definition ",
                     " is incomplete");
     else if (declToken.getType() == Token::functdecl)
-      logTokenError(cout, declToken, "Declaration of function ",
+      logTokenError(*_log, incompleteDeclaration, declToken, "Declaration of function ",
                     " is incomplete");
     else
-      logTokenError(cout, declToken, "Prototype of function ",
+      logTokenError(*_log, incompleteDeclaration, declToken, "Prototype of function ",
                     " is incomplete");
   }
 
@@ -424,10 +432,10 @@ void Parser::procFunctDeclaration(Token& declToken, const Token& nextToken,
   if (_braceCount > 0) {
     // Typedefs are ignored if this problem exists
     if (declToken.getType() == Token::functdecl)
-      logTokenError(cout, declToken, "Declaration of function ",
+      logTokenError(*_log, nestedFunction, declToken, "Declaration of function ",
                     " occurs within another function");
     else
-      logTokenError(cout, declToken, "Prototype of function ",
+      logTokenError(*_log, nestedFunction, declToken, "Prototype of function ",
                     " occurs within another function");
   }
   // update the symbol table
@@ -439,15 +447,299 @@ void Parser::procFunctDeclaration(Token& declToken, const Token& nextToken,
   _parseStack.clear();
 }
 
+// Returns true if the token comes from a source file the filter excludes
+bool Parser::isExcluded(const Token& token)
+{
+  // Files change rarely, so only check the filter when they do
+  const InternedString& fileName = token.getFilePosition().getInternedFileName();
+  if (fileName != _regionFile) {
+    _regionFile = fileName;
+    _regionExcluded = _filter->isExcluded(fileName.str());
+  }
+  return _regionExcluded;
+}
+
+/* Returns true if the identifier is a compiler extension which takes a
+   parenthesized argument and is not part of a declarator, or a statement
+   which declares nothing */
+static bool isExtension(const Token& token)
+{
+  const string& lexeme = token.getLexeme();
+  return ((lexeme == "__attribute__") || (lexeme == "__attribute") ||
+          (lexeme == "__asm__") || (lexeme == "__asm") || (lexeme == "asm") ||
+          (lexeme == "_Static_assert"));
+}
+
+// Returns the number of times the char appears in the token text
+static int countChar(const Token& token, char wanted)
+{
+  const string& lexeme = token.getLexeme();
+  return std::count(lexeme.begin(), lexeme.end(), wanted);
+}
+
+/* Reads a statement from an excluded source file, starting with the current
+   token. Most of such a file is typedefs and prototypes, which the rest of the
+   file needs in the symbol table, but nothing in it is reported. Instead of
+   the full parse, the statement is read up to its semicolon and split into
+   declarators, and each one only needs its name and whether it is a function.
+   Function bodies are skipped by counting braces, so calls within them are
+   never seen */
+void Parser::skimStatement()
+{
+  int parenCount = 0;
+  int braceCount = 0;
+  bool isTypedef = false;
+  bool isStatic = false;
+  bool haveInit = false; // True, found the initial value of a declaration
+  bool haveBody = false;
+  unsigned int first;
+  unsigned int index;
+
+  bool haveMark = false; // True, a region mark ended the statement early
+
+  _skimTokens.clear();
+  while (true) {
+    if (_currToken.isTypeIn(_RegionMarks)) {
+      haveMark = true;
+      break;
+    }
+    if (_currToken.getType() == Token::identifier)
+      _symbolTable.checkForSymbol(_currToken);
+    if (_currToken.getType() == Token::tokenEOF)
+      break;
+    if ((parenCount == 0) && (braceCount == 0)) {
+      if (_currToken.getType() == Token::semicolon)
+        break;
+      else if (_currToken.getType() == Token::typedeftoken)
+        isTypedef = true;
+      else if (_currToken.getType() == Token::statictoken)
+        isStatic = true;
+      else if ((_currToken.getType() == Token::othersymbol) &&
+               (countChar(_currToken, '=') > 0))
+        haveInit = true;
+      // A function body follows the parameter list
+      else if ((_currToken.getType() == Token::openbrace) && (!isTypedef) &&
+               (!haveInit) && (!_skimTokens.empty()) &&
+               (_skimTokens.back().getType() == Token::closeparen)) {
+        haveBody = true;
+        break;
+      }
+    }
+    if (_currToken.getType() == Token::openparen)
+      parenCount++;
+    else if ((_currToken.getType() == Token::closeparen) && (parenCount > 0))
+      parenCount--;
+    else if (_currToken.getType() == Token::openbrace)
+      braceCount++;
+    else if ((_currToken.getType() == Token::closebrace) && (braceCount > 0))
+      braceCount--;
+    _skimTokens.push_back(_currToken);
+    if (_buffer.haveEOF())
+      break;
+    _currToken = _buffer.nextToken();
+  }
+
+  if (haveBody) {
+    braceCount = 1;
+    while ((braceCount > 0) && (!_buffer.haveEOF())) {
+      _currToken = _buffer.nextToken();
+      if (_currToken.getType() == Token::openbrace)
+        braceCount++;
+      else if (_currToken.getType() == Token::closebrace)
+        braceCount--;
+    }
+  }
+
+  // Declarators are split by commas outside any parentheses or braces
+  parenCount = 0;
+  braceCount = 0;
+  first = 0;
+  for (index = 0; index < _skimTokens.size(); index++) {
+    const Token& token = _skimTokens[index];
+    if (token.getType() == Token::openparen)
+      parenCount++;
+    else if (token.getType() == Token::closeparen)
+      parenCount--;
+    else if (token.getType() == Token::openbrace)
+      braceCount++;
+    else if (token.getType() == Token::closebrace)
+      braceCount--;
+    else if ((parenCount == 0) && (braceCount == 0) &&
+             ((token.getType() == Token::declsymbol) ||
+              (token.getType() == Token::othersymbol)) &&
+             (countChar(token, ',') > 0)) {
+      skimDeclarator(first, index, isTypedef, isStatic, false);
+      first = index + 1;
+    }
+  }
+  skimDeclarator(first, _skimTokens.size(), isTypedef, isStatic, haveBody);
+  if (!haveMark)
+    _currToken.setToNoToken();
+  else {
+    // The rest of the statement is not in the region, so it can't be cached
+    _regionSkimmed = false;
+    _readNextToken = false;
+  }
+}
+
+// Adds the name declared by part of a skimmed statement to the symbol table
+void Parser::skimDeclarator(unsigned int first, unsigned int last,
+                            bool isTypedef, bool isStatic, bool haveBody)
+{
+  int parenCount = 0;
+  int braceCount = 0;
+  int bracketCount = 0; // Array sizes may hold names, but don't declare them
+  int nameParens = 0; // Parentheses around the name
+  const Token* name = NULL;
+  bool haveNameEnd = false; // True, passed the parenthese closing around the name
+  bool isFunction = false;
+  unsigned int index;
+
+  /* The name is the last identifier outside any parameter list. If its
+     parentheses are followed by another, it is a function. If parentheses
+     around it close first, it is a pointer to a function */
+  for (index = first; (index < last) && (!isFunction); index++) {
+    const Token& token = _skimTokens[index];
+    if (braceCount > 0) {
+      // Contents of a compound type or initial value
+      if (token.getType() == Token::openbrace)
+        braceCount++;
+      else if (token.getType() == Token::closebrace)
+        braceCount--;
+      continue;
+    }
+    switch (token.getType()) {
+    case Token::identifier:
+      if (isExtension(token)) {
+        // Skip its argument
+        if (((index + 1) < last) && (_skimTokens[index + 1].getType() == Token::openparen)) {
+          int argParens = 0;
+          do {
+            index++;
+            if (_skimTokens[index].getType() == Token::openparen)
+              argParens++;
+            else if (_skimTokens[index].getType() == Token::closeparen)
+              argParens--;
+          } while ((argParens > 0) && ((index + 1) < last));
+        }
+      }
+      else if ((bracketCount == 0) && (!haveNameEnd)) {
+        name = &token;
+        nameParens = parenCount;
+      }
+      break;
+
+    case Token::compound:
+      // Skip the tag, which is not a declared name
+      if (((index + 1) < last) && (_skimTokens[index + 1].getType() == Token::identifier))
+        index++;
+      break;
+
+    case Token::openparen:
+      if ((name != NULL) && (bracketCount == 0)) {
+        if (haveNameEnd)
+          index = last; // Rest is the parameters of a function pointer
+        else if (parenCount == nameParens)
+          isFunction = true;
+      }
+      parenCount++;
+      break;
+
+    case Token::closeparen:
+      parenCount--;
+      if ((name != NULL) && (parenCount < nameParens))
+        haveNameEnd = true;
+      break;
+
+    case Token::openbrace:
+      braceCount++;
+      break;
+
+    case Token::declsymbol:
+    case Token::othersymbol:
+      bracketCount += countChar(token, '[') - countChar(token, ']');
+      // Everything after the start of the initial value is ignored
+      if ((token.getType() == Token::othersymbol) && (countChar(token, '=') > 0) &&
+          (parenCount == 0))
+        index = last;
+      break;
+
+    default:
+      break;
+    }
+  }
+  if (name == NULL)
+    return;
+
+  Token declToken(*name);
+  if (isTypedef && isFunction)
+    declToken.setType(Token::functtypedef);
+  else if (isTypedef)
+    declToken.setType(Token::typetoken);
+  else if (isFunction && haveBody)
+    declToken.setType(Token::functdecl);
+  else if (isFunction)
+    declToken.setType(Token::functproto);
+  else
+    declToken.setType(Token::varname);
+  if (isFunction && isStatic)
+    declToken.setScope(Token::filescope);
+  else if (isFunction)
+    declToken.setScope(Token::globalscope);
+  else
+    declToken.setScope(Token::filescope);
+  // Nothing from an excluded file is output, including warnings
+  _symbolTable.setLog(_noLog);
+  _symbolTable.updateNameSpace(declToken);
+  _symbolTable.setLog(*_log);
+  if (_regionSkimmed)
+    _regionTokens.push_back(declToken);
+}
+
+/* Handles the tokens marking the regions of excluded text. A cached region
+   adds the names it declares to the symbol table, as skimming it again would.
+   Otherwise the names skimmed from the region are kept, and cached once it
+   ends. A region is only cached if all of it was skimmed, since otherwise the
+   names depend on the text before it */
+void Parser::procRegion()
+{
+  if (_currToken.getType() == Token::cachedregion) {
+    const vector<Token>* declarations = NULL;
+    if (_headerCache != NULL)
+      declarations = _headerCache->find(_currToken.getInternedLexeme());
+    if (declarations != NULL) {
+      _symbolTable.setLog(_noLog);
+      for (vector<Token>::const_iterator index = declarations->begin();
+           index != declarations->end(); index++)
+        _symbolTable.updateNameSpace(*index);
+      _symbolTable.setLog(*_log);
+    }
+  }
+  else if (_currToken.getType() == Token::regionstart) {
+    _regionKey = _currToken.getInternedLexeme();
+    _regionSkimmed = true;
+    _regionTokens.clear();
+  }
+  else {
+    if (_regionSkimmed && (_headerCache != NULL))
+      _headerCache->store(_regionKey, _regionTokens);
+    _regionKey = InternedString();
+    _regionSkimmed = false;
+  }
+  _currToken.setToNoToken();
+}
+
 // Finds the next function token in the file
 void Parser::findNextFunction()
 {
   int conParenCount = 0; // Number of consecutive open paranthese found
   Token tempToken;
+  STATS_TIMER(parseStage);
 
   _functToken.setToNoToken(); // Clear last function
   while ((_functToken.getType() == Token::notoken) && (!_buffer.haveEOF())) {
     // Get next token to parse
+    bool freshToken = _readNextToken;
     if (_readNextToken)
         _currToken = _buffer.nextToken();
     else {
@@ -455,6 +747,25 @@ void Parser::findNextFunction()
         _buffer.resetLookahead();
     }
 
+    if (_currToken.isTypeIn(_RegionMarks)) {
+        procRegion();
+        continue;
+    }
+
+    /* Statements from excluded source files are only skimmed for what they
+       declare. This needs the start of a statement outside any function */
+    if (freshToken && (_filter != NULL) && (_braceCount == 0) &&
+        (_statementType == undet) && _parseStack.empty() &&
+        (_currToken.getType() != Token::semicolon) &&
+        (_currToken.getType() != Token::closebrace) && isExcluded(_currToken)) {
+        skimStatement();
+        conParenCount = 0;
+        continue;
+    }
+    // Stray semicolons between statements don't change the symbol table
+    if ((_currToken.getType() != Token::semicolon) || (_statementType != undet))
+        _regionSkimmed = false;
+
     // Check for symbolic name
     if (_currToken.getType() == Token::identifier)
         _symbolTable.checkForSymbol(_currToken);
@@ -596,7 +907,7 @@ void Parser::findNextFunction()
                 // Issue a warning if the call is refrenced from a struct
                 if ((!_parseStack.empty()) &&
                     (_parseStack.back().getType() == Token::fieldaccess))
-                    logTokenError(cout, _currToken, "Function call ",
+                    logTokenError(*_log, structCall, _currToken, "Function call ",
                                   " is an element of a structured type");
             }
             else {
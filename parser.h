@@ -21,6 +21,9 @@
     a link to the code depository)
 */
 // parser.h
+class RegionFilter; // Decides which source files are indexed, see regionfilter.h
+class HeaderCache; // Keeps what excluded header text declares, see headercache.h
+
 class Parser {
  private:
     // Stack of token objects
@@ -57,9 +60,28 @@ class Parser {
   bool _readNextToken; // True, need to reload input before parsing
   Token _currToken; // Current token to process
   Token _functToken; // Last found function token
+  // Tokens ending the declaration of a compound type, if its braces don't
+  static constexpr Token::TypeSet _CompoundEnds =
+    Token::typeSet(Token::closebrace) | Token::typeSet(Token::semicolon) |
+    Token::typeSet(Token::functcall) | Token::typeSet(Token::control) |
+    Token::typeSet(Token::reserved) | Token::typeSet(Token::tokenEOF);
+  // Tokens marking the regions of excluded text, see procRegion()
+  static constexpr Token::TypeSet _RegionMarks =
+    Token::typeSet(Token::cachedregion) | Token::typeSet(Token::regionstart) |
+    Token::typeSet(Token::regionend);
   // Type of statement being processed
   enum { undet, declaration, expression, constmt } _statementType;
   int _braceCount; // Count of unmatched open braces
+  ostream* _log; // Destination of warning messages
+  const RegionFilter* _filter; // NULL if every source file is indexed
+  InternedString _regionFile; // Source file last checked against the filter
+  bool _regionExcluded; // True, that file is excluded
+  vector<Token> _skimTokens; // Statement being skimmed from an excluded file
+  ostream _noLog; // Discards warnings about excluded files
+  HeaderCache* _headerCache; // NULL if excluded regions are not cached
+  InternedString _regionKey; // Excluded region being read
+  bool _regionSkimmed; // True, everything in that region so far was skimmed
+  vector<Token> _regionTokens; // Names declared in that region so far
 
   // Completes processing of a statement
   void newStatement();
@@ -77,6 +99,20 @@ class Parser {
   // Finds the next function in the source file
   void findNextFunction();
 
+  // Returns true if the token comes from a source file the filter excludes
+  bool isExcluded(const Token& token);
+
+  /* Reads a statement from an excluded source file, starting with the current
+     token. Only the names it declares are used, see below */
+  void skimStatement();
+
+  // Adds the name declared by part of a skimmed statement to the symbol table
+  void skimDeclarator(unsigned int first, unsigned int last, bool isTypedef,
+                      bool isStatic, bool haveBody);
+
+  // Handles the tokens marking the regions of excluded text
+  void procRegion();
+
   // Resets parser to initial state
   void init();
 
@@ -94,6 +130,24 @@ class Parser {
   // Starts the parser on the named file
   void start(const string& fileName);
 
+  // Reports problems still pending from the current file
+  void finish();
+
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
+  // Sets whether files are read and lexed on separate threads
+  void setPipelined(bool pipelined);
+
+  // Sets the filter deciding which source files are indexed, or NULL for all of them
+  void setFilter(const RegionFilter* filter);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(HeaderCache* headerCache);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
+
   // Finds and returns the next function token in the file
   Token nextFunction();
 
@@ -109,6 +163,50 @@ inline void Parser::start(const string& fileName)
     findNextFunction();
 }
 
+/* Reports problems still pending from the current file. Starting the next
+   file will do this anyway; this allows the report to be taken before then */
+inline void Parser::finish()
+{
+    init();
+}
+
+// Sets where warning messages are written
+inline void Parser::setLog(ostream& log)
+{
+    _log = &log;
+    _buffer.setLog(log);
+    _symbolTable.setLog(log);
+}
+
+// Sets whether files are read and lexed on separate threads
+inline void Parser::setPipelined(bool pipelined)
+{
+    _buffer.setPipelined(pipelined);
+}
+
+// Sets the filter deciding which source files are indexed, or NULL for all of them
+inline void Parser::setFilter(const RegionFilter* filter)
+{
+    _filter = filter;
+    _regionFile = InternedString();
+    _regionExcluded = false;
+    // gcc marks system headers with flags after the file name
+    _buffer.setMarkerFlags(filter != NULL);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void Parser::setHeaderCache(HeaderCache* headerCache)
+{
+    _headerCache = headerCache;
+    _buffer.setHeaderCache(headerCache);
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void Parser::setCopyFiles(bool copyFiles)
+{
+    _buffer.setCopyFiles(copyFiles);
+}
+
 // Resets parser to initial state
 inline void Parser::init()
 {
@@ -117,6 +215,10 @@ inline void Parser::init()
   _functToken.setToNoToken();
   _statementType = undet;
   _braceCount = 0;
+  _regionKey = InternedString();
+  _regionSkimmed = false;
+  _regionFile = InternedString(); // Its text may be freed between files
+  _regionExcluded = false;
   _symbolTable.clearGlobalNames();
   newStatement();
 }
@@ -128,7 +230,7 @@ inline void Parser::newStatement()
   while (!_parseStack.empty()) {
     temp = _parseStack.popTillType(Token::functcall);
     if (temp.getType() != Token::notoken)
-      logTokenError(std::cout, temp, "Call of function ", " is incomplete");
+      logTokenError(*_log, incompleteCall, temp, "Call of function ", " is incomplete");
   }
   _statementType = undet;
 }
@@ -161,7 +263,7 @@ inline Token Parser::TokenStack::pop()
 {
   Token temp;
   if (!empty()) {
-    temp = back();
+    temp = std::move(back());
     pop_back();
   }
   return temp;
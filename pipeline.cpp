@@ -0,0 +1,133 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// pipeline.cpp Reads and lexes one file on separate threads
+
+#include<string>
+#include<chrono>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+#include<vector>
+#include<utility>
+#include<atomic>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include"basetypes.h"
+#include"indexstats.h"
+#include"errors.h"
+#include"filebuffer.h"
+#include"spscqueue.h"
+#include"tokenizer.h"
+#include"pipeline.h"
+
+using std::string;
+
+// Constructor
+FilePipeline::FilePipeline()
+    : _lines(_QueueBatches), _tokens(_QueueBatches)
+{
+  _readStats.clear();
+  _lexStats.clear();
+}
+
+// Destructor. Stops the stage threads
+FilePipeline::~FilePipeline()
+{
+  stop();
+}
+
+// Starts the stages on the named file
+void FilePipeline::start(const string& fileName)
+{
+  stop();
+  _lines.reset();
+  _tokens.reset();
+  _fileName = fileName;
+  // Open here, so a missing file is reported to the caller
+  _readLog.str("");
+  _reader.setLog(_readLog);
+  _reader.open(fileName);
+  _readThread = thread(&FilePipeline::readFile, this);
+  _lexThread = thread(&FilePipeline::lexFile, this);
+}
+
+/* Stops the stage threads, whether or not they finished the file, and adds
+   the work they did to the statistics for this thread */
+void FilePipeline::stop()
+{
+  if (_readThread.joinable()) {
+    _lines.cancel();
+    _tokens.cancel();
+    _readThread.join();
+    _lexThread.join();
+    IndexStats::_current.add(_readStats);
+    IndexStats::_current.add(_lexStats);
+  }
+}
+
+// First stage, reads the file in batches of lines
+void FilePipeline::readFile()
+{
+  IndexStats::_current.clear();
+  LineBatch batch;
+  bool last;
+  do {
+    _reader.readLines(batch, _BatchLines);
+    last = batch.last; // Pushing swaps out the batch
+  } while (_lines.push(batch) && (!last));
+  _reader.close();
+  _readStats = IndexStats::_current;
+}
+
+// Second stage, lexes the lines from the first into batches of tokens
+void FilePipeline::lexFile()
+{
+  IndexStats::_current.clear();
+  TokenBatch batch;
+  bool last = false;
+  // Warnings from opening the file come first, in a batch of their own
+  _lexLog.str("");
+  _lexLog << _readLog.str();
+  _lexer.setLog(_lexLog);
+  _lexer.start(_fileName, _lines);
+  batch.log = _lexLog.str();
+  _lexLog.str("");
+  bool running = _tokens.push(batch);
+  while (running && (!last)) {
+    batch.clear();
+    last = _lexer.haveEOF();
+    if (last)
+      _lexer.nextTokens(batch.tokens, 1); // Only the end of file token
+    else
+      // Lex whole lines, so each batch ends where a line's text runs out
+      while ((!_lexer.haveEOF()) && (batch.tokens.size() < _BatchTokens)) {
+        _lexer.nextTokens(batch.tokens, _BatchTokens - batch.tokens.size());
+        if (_lexLog.tellp() > 0)
+          batch.addLog(_lexLog);
+      }
+    batch.last = last;
+    running = _tokens.push(batch);
+  }
+  _lexStats = IndexStats::_current;
+}
@@ -0,0 +1,112 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// pipeline.h Reads and lexes one file on separate threads
+using std::thread;
+using std::ostringstream;
+
+/* Splits the work on a single file into stages on their own threads, for
+   files too big for indexing files in parallel to help. One thread reads the
+   file and strips comments and preprocessor commands, a second lexes the
+   lines, and the thread using this object parses the tokens. The stages pass
+   batches through bounded queues, so a fast stage waits for a slow one
+   instead of holding the whole file in memory. Warnings travel with the
+   batches, so the output is the same as for a file processed on one thread */
+class FilePipeline
+{
+ private:
+  static const unsigned int _QueueBatches = 4; // Batches a stage may get ahead
+  static const unsigned int _BatchLines = 512;
+  static const unsigned int _BatchTokens = 2048;
+
+  string _fileName;
+  FileBuffer _reader; // First stage
+  Tokenizer _lexer; // Second stage, lexes lines from the first
+  ostringstream _readLog; // Warnings from opening the file
+  ostringstream _lexLog; // Warnings from the second stage, to pass on
+  LineQueue _lines;
+  TokenQueue _tokens;
+  thread _readThread;
+  thread _lexThread;
+  IndexStats _readStats; // Work done by each stage thread
+  IndexStats _lexStats;
+
+  // Stage thread functions
+  void readFile();
+  void lexFile();
+
+  // This object controls threads, so it can't be copied
+  FilePipeline(const FilePipeline& other);
+  FilePipeline& operator=(const FilePipeline& other);
+
+ public:
+  // Constructor
+  FilePipeline();
+
+  // Destructor. Stops the stage threads
+  ~FilePipeline();
+
+  /* Starts the stages on the named file. Throws a file not found exception if
+     the file can't be opened */
+  void start(const string& fileName);
+
+  // Sets whether line markers may be followed by flags
+  void setMarkerFlags(bool markerFlags);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(const HeaderCache* headerCache);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
+
+  /* Waits for the next batch of tokens. Returns false if the pipeline was
+     stopped */
+  bool nextBatch(TokenBatch& batch);
+
+  /* Stops the stage threads, whether or not they finished the file, and adds
+     the work they did to the statistics for this thread */
+  void stop();
+};
+
+// Sets whether line markers may be followed by flags
+inline void FilePipeline::setMarkerFlags(bool markerFlags)
+{
+  _reader.setMarkerFlags(markerFlags);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void FilePipeline::setHeaderCache(const HeaderCache* headerCache)
+{
+  _reader.setHeaderCache(headerCache);
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void FilePipeline::setCopyFiles(bool copyFiles)
+{
+  _reader.setCopyFiles(copyFiles);
+}
+
+// Waits for the next batch of tokens
+inline bool FilePipeline::nextBatch(TokenBatch& batch)
+{
+  return _tokens.pop(batch);
+}
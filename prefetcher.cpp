@@ -0,0 +1,115 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// prefetcher.cpp Reads files ahead of the indexer
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "basetypes.h"
+#include "prefetcher.h"
+
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::lock_guard;
+using std::unique_lock;
+
+// The files are read in the order given, up to the count ahead of the indexer
+FilePrefetcher::FilePrefetcher(const vector<string>& fileNames, unsigned int ahead)
+    : _fileNames(fileNames), _ahead(ahead), _nextFile(0), _indexed(0),
+      _stopping(false)
+{
+}
+
+// Destructor. Stops the threads, whether or not they read every file
+FilePrefetcher::~FilePrefetcher()
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    _stopping = true;
+  }
+  _moved.notify_all();
+  unsigned int index;
+  for (index = 0; index < _workers.size(); index++)
+    _workers[index].join();
+}
+
+// Starts reading the files
+void FilePrefetcher::start()
+{
+  unsigned int threadCount = (_ahead < _MaxThreads) ? _ahead : _MaxThreads;
+  unsigned int index;
+  for (index = 0; index < threadCount; index++)
+    _workers.push_back(thread(&FilePrefetcher::worker, this));
+}
+
+// Tells the object the indexed file is being indexed, so later ones can be read
+void FilePrefetcher::advance(unsigned int fileIndex)
+{
+  {
+    lock_guard<mutex> guard(_lock);
+    if (fileIndex <= _indexed)
+      return;
+    _indexed = fileIndex;
+    // No point reading a file the indexer has already passed
+    if (_nextFile < _indexed)
+      _nextFile = _indexed;
+  }
+  _moved.notify_all();
+}
+
+// Returns the index of the next file to read, or the file count if none remain
+unsigned int FilePrefetcher::takeNextFile()
+{
+  unique_lock<mutex> guard(_lock);
+  while ((!_stopping) && (_nextFile < _fileNames.size()) &&
+         (_nextFile > (_indexed + _ahead)))
+    _moved.wait(guard);
+  if ((!_stopping) && (_nextFile < _fileNames.size()))
+    return _nextFile++;
+  else
+    return _fileNames.size();
+}
+
+// Reads files until none remain
+void FilePrefetcher::worker()
+{
+  vector<char> buffer(_ReadSize);
+  unsigned int fileIndex = takeNextFile();
+  while (fileIndex < _fileNames.size()) {
+    readFile(_fileNames[fileIndex], buffer);
+    fileIndex = takeNextFile();
+  }
+}
+
+// Reads the named file into the buffer, a part at a time
+void FilePrefetcher::readFile(const string& fileName, vector<char>& buffer)
+{
+  // Files that can't be read are reported when they are indexed
+  ifstream file(fileName.c_str(), ifstream::binary);
+  while (file.read(&buffer[0], buffer.size()))
+    ;
+}
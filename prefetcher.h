@@ -0,0 +1,77 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// prefetcher.h Reads files ahead of the indexer
+using std::mutex;
+using std::condition_variable;
+using std::thread;
+
+/* On slow or network storage most of the time indexing many small files goes
+   to waiting for each one to be opened and read. This object reads the files
+   ahead of the one being indexed, on threads of its own, so they are in the
+   system's file cache by the time the file buffer maps them. Several threads
+   read at once, so the waits overlap with each other as well as with the
+   indexing. Only a limited number of files are read ahead, since the cache
+   only holds so much.
+     The portable way to get a file into the cache is to read it, so that is
+   what this does; the data read is thrown away */
+class FilePrefetcher
+{
+ private:
+  static const unsigned int _MaxThreads = 8;
+  static const unsigned int _ReadSize = 65536; // Bytes read at a time
+
+  const vector<string>& _fileNames;
+  unsigned int _ahead; // Files read ahead of the one being indexed
+  unsigned int _nextFile; // Next file to read
+  unsigned int _indexed; // File being indexed
+  bool _stopping;
+  mutex _lock; // Protects all of the above
+  condition_variable _moved; // Signaled when the indexer moves to another file
+  vector<thread> _workers;
+
+  // Reads files until none remain
+  void worker();
+
+  // Returns the index of the next file to read, or the file count if none remain
+  unsigned int takeNextFile();
+
+  // Reads the named file into the buffer, a part at a time
+  static void readFile(const string& fileName, vector<char>& buffer);
+
+  // Copy constructor and assignment operator. This object can't be copied
+  FilePrefetcher(const FilePrefetcher& other);
+  const FilePrefetcher& operator=(const FilePrefetcher& other);
+
+ public:
+  // The files are read in the order given, up to the count ahead of the indexer
+  FilePrefetcher(const vector<string>& fileNames, unsigned int ahead);
+
+  // Destructor. Stops the threads, whether or not they read every file
+  ~FilePrefetcher();
+
+  // Starts reading the files
+  void start();
+
+  // Tells the object the indexed file is being indexed, so later ones can be read
+  void advance(unsigned int fileIndex);
+};
@@ -0,0 +1,81 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// regionfilter.cpp Decides which source files the index covers
+
+#include <string>
+#include <vector>
+#include "basetypes.h"
+#include "regionfilter.h"
+
+using std::string;
+using std::vector;
+
+RegionFilter::RegionFilter()
+{
+}
+
+// Returns the length of the longest path in the list containing the file, or -1
+int RegionFilter::longestMatch(const vector<string>& paths, const string& fileName)
+{
+  int longest = -1;
+  vector<string>::const_iterator index;
+  for (index = paths.begin(); index != paths.end(); index++)
+    // The path must match whole directory names, so /usr/inc is not /usr/include
+    if (((int)index->length() > longest) &&
+        (fileName.compare(0, index->length(), *index) == 0) &&
+        ((fileName.length() == index->length()) || (fileName[index->length()] == '/') ||
+         ((!index->empty()) && ((*index)[index->length() - 1] == '/'))))
+      longest = index->length();
+  return longest;
+}
+
+// Indexes files within the path, even if a shorter excluded path contains them
+void RegionFilter::include(const string& path)
+{
+  _included.push_back(path);
+}
+
+// Does not index files within the path, unless a longer included path contains them
+void RegionFilter::exclude(const string& path)
+{
+  _excluded.push_back(path);
+}
+
+// Returns true if text from the named source file should not be indexed
+bool RegionFilter::isExcluded(const string& fileName) const
+{
+  int excluded = longestMatch(_excluded, fileName);
+  return ((excluded >= 0) && (excluded > longestMatch(_included, fileName)));
+}
+
+// Returns text describing the filter
+string RegionFilter::describe() const
+{
+  string result;
+  vector<string>::const_iterator index;
+  for (index = _included.begin(); index != _included.end(); index++)
+    result += "+" + *index + '\n';
+  for (index = _excluded.begin(); index != _excluded.end(); index++)
+    result += "-" + *index + '\n';
+  return result;
+}
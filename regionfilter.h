@@ -0,0 +1,66 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// regionfilter.h Decides which source files the index covers
+
+/* This object decides which parts of the preprocessor output to index, by the
+   source file each part came from. Paths are excluded, and paths within them
+   included again, by their leading directories; the longest path matching a
+   file decides. Most preprocessor output comes from system headers, so
+   excluding them (such as /usr/include) leaves far less to parse.
+     Excluded text is still skimmed for the declarations it makes, since the
+   rest of the file depends on them, but nothing in it is output */
+class RegionFilter
+{
+ private:
+  vector<string> _included;
+  vector<string> _excluded;
+
+  // Returns the length of the longest path in the list containing the file, or -1
+  static int longestMatch(const vector<string>& paths, const string& fileName);
+
+ public:
+  RegionFilter();
+
+  // This object uses the default copy constructor, assignment operator, and destructor
+
+  // Indexes files within the path, even if a shorter excluded path contains them
+  void include(const string& path);
+
+  // Does not index files within the path, unless a longer included path contains them
+  void exclude(const string& path);
+
+  // Returns true if no paths are excluded
+  bool empty() const;
+
+  // Returns true if text from the named source file should not be indexed
+  bool isExcluded(const string& fileName) const;
+
+  /* Returns text describing the filter. Results indexed with different
+     filters differ, so it is part of the cache name */
+  string describe() const;
+};
+
+inline bool RegionFilter::empty() const
+{
+  return _excluded.empty();
+}
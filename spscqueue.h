@@ -0,0 +1,166 @@
+/* This file is part of ProgramIndexer. It indexes function declarations,
+    prototypes, and calls in C programs; and lists issues with functions
+    including name collisions and shadow situations.
+
+    Copyright (C) 2013   Ezra Erb
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as published
+    by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    I'd appreciate a note if you find this program useful or make
+    updates. Please contact me through LinkedIn or github (my profile also has
+    a link to the code depository)
+*/
+// spscqueue.h Queue for passing batches of work from one thread to another
+using std::vector;
+using std::atomic;
+using std::mutex;
+using std::condition_variable;
+using std::unique_lock;
+using std::lock_guard;
+
+/* A bounded queue between one producing thread and one consuming thread.
+   Each end only writes its own counter, so no locks are needed. Items are
+   swapped in and out rather than copied, which hands their storage back to
+   the producer to reuse. A thread that finds the queue full (or empty) yields
+   for a short while for the other to catch up, which keeps the producer from
+   getting too far ahead. If that is not enough it sleeps until the other end
+   changes the queue, so a stalled thread does not burn a processor. Either
+   thread can cancel the queue, which makes both ends fail */
+template <class T> class SpscQueue
+{
+ private:
+  enum { _SpinLimit = 64 }; // Yields before a waiting thread sleeps
+
+  vector<T> _slots; // Size is always a power of two
+  atomic<size_t> _head; // Count of items popped, only changed by the consumer
+  atomic<size_t> _tail; // Count of items pushed, only changed by the producer
+  atomic<bool> _cancelled;
+  atomic<unsigned int> _sleepers; // Threads asleep, or about to sleep, in block()
+  mutex _lock; // Only used by sleeping threads and the ones waking them
+  condition_variable _changed;
+
+  // Waits until the counter differs from the value seen, or the queue is cancelled
+  void block(const atomic<size_t>& counter, size_t seen);
+
+  // Wakes the other thread, if it is asleep
+  void wake();
+
+  // The slots are shared by two threads, so the queue can't be copied
+  SpscQueue(const SpscQueue& other);
+  SpscQueue& operator=(const SpscQueue& other);
+
+ public:
+  // Constructor. The size is rounded up to a power of two
+  explicit SpscQueue(unsigned int size);
+
+  // Empties the queue. Only call when neither thread is using it
+  void reset();
+
+  /* Adds an item, waiting for room. The item is left with the old contents of
+     its slot. Returns false if the queue was cancelled */
+  bool push(T& item);
+
+  /* Removes the oldest item into the given one, waiting for one to exist.
+     Returns false if the queue was cancelled */
+  bool pop(T& item);
+
+  // Makes both ends fail, so neither thread waits forever
+  void cancel();
+};
+
+template <class T> SpscQueue<T>::SpscQueue(unsigned int size)
+    : _head(0), _tail(0), _cancelled(false), _sleepers(0)
+{
+  unsigned int slotCount = 1;
+  while (slotCount < size)
+    slotCount *= 2;
+  _slots.resize(slotCount);
+}
+
+template <class T> inline void SpscQueue<T>::reset()
+{
+  _head = 0;
+  _tail = 0;
+  _cancelled = false;
+}
+
+// Waits until the counter differs from the value seen, or the queue is cancelled
+template <class T> void SpscQueue<T>::block(const atomic<size_t>& counter, size_t seen)
+{
+  unique_lock<mutex> guard(_lock);
+  /* Announce the sleep before checking again. Either the other thread sees
+     this and wakes this one, or this one sees the other thread's change */
+  _sleepers.fetch_add(1);
+  while ((counter.load() == seen) && (!_cancelled.load()))
+    _changed.wait(guard);
+  _sleepers.fetch_sub(1);
+}
+
+// Wakes the other thread, if it is asleep
+template <class T> inline void SpscQueue<T>::wake()
+{
+  // Orders the change to the queue before the check, see block()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleepers.load(std::memory_order_relaxed) > 0) {
+    lock_guard<mutex> guard(_lock);
+    _changed.notify_all();
+  }
+}
+
+template <class T> bool SpscQueue<T>::push(T& item)
+{
+  size_t tail = _tail.load(std::memory_order_relaxed);
+  unsigned int spins = 0;
+  while ((tail - _head.load(std::memory_order_acquire)) == _slots.size()) {
+    if (_cancelled.load(std::memory_order_relaxed))
+      return false;
+    if (spins < _SpinLimit) {
+      std::this_thread::yield();
+      spins++;
+    }
+    else
+      block(_head, tail - _slots.size());
+  }
+  if (_cancelled.load(std::memory_order_relaxed))
+    return false;
+  std::swap(_slots[tail & (_slots.size() - 1)], item);
+  _tail.store(tail + 1, std::memory_order_release);
+  wake();
+  return true;
+}
+
+template <class T> bool SpscQueue<T>::pop(T& item)
+{
+  size_t head = _head.load(std::memory_order_relaxed);
+  unsigned int spins = 0;
+  while (_tail.load(std::memory_order_acquire) == head) {
+    if (_cancelled.load(std::memory_order_relaxed))
+      return false;
+    if (spins < _SpinLimit) {
+      std::this_thread::yield();
+      spins++;
+    }
+    else
+      block(_tail, head);
+  }
+  std::swap(item, _slots[head & (_slots.size() - 1)]);
+  _head.store(head + 1, std::memory_order_release);
+  wake();
+  return true;
+}
+
+template <class T> inline void SpscQueue<T>::cancel()
+{
+  _cancelled = true;
+  wake();
+}
@@ -0,0 +1,23 @@
+# 1 "knr.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "knr.c"
+int add(a, b)
+int a;
+int b;
+{
+  return a + b;
+}
+
+char *pick(s, n)
+char *s;
+int n;
+{
+  return s + add(n, 0);
+}
+
+unsigned long
+returns_on_own_line(void)
+{
+  return 0;
+}
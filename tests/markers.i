@@ -0,0 +1,26 @@
+# 1 "markers.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "markers.c"
+# 1 "/usr/include/helper.h" 1 3 4
+extern int helper(int value);
+static inline int local_helper(int value)
+{
+  return helper(value);
+}
+# 2 "markers.c" 2
+
+int uses_helper(int value)
+{
+  return local_helper(value) + helper(value);
+}
+# 40 "markers.c"
+int far_down(void)
+{
+  return uses_helper(4);
+}
+#line 100 "renamed.c"
+int renamed(void)
+{
+  return far_down();
+}
@@ -0,0 +1,30 @@
+# 1 "pointers.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "pointers.c"
+typedef int (*handler_t)(int);
+int (*global_handler)(int);
+
+static int twice(int a)
+{
+  return a * 2;
+}
+
+int (*get_handler(void))(int)
+{
+  return twice;
+}
+
+void apply(int (*fn)(int), int value)
+{
+  handler_t local = get_handler();
+  (*fn)(value);
+  local(value);
+  global_handler = twice;
+}
+
+void (*signal_like(int sig, void (*func)(int)))(int)
+{
+  apply(twice, sig);
+  return func;
+}
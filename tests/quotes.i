@@ -0,0 +1,24 @@
+# 1 "quotes.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "quotes.c"
+const char *message(void)
+{
+  return "not_a_call(1); /* nor a comment */ \
+still_not(2); ' \" { } ";
+}
+
+char quote(void)
+{
+  return '"';
+}
+
+int braces(void)
+{
+  const char *open = "{";
+  const char *close = "}";
+  /* a comment with a "quote" and fake(3) call
+     over two lines { */
+  message();
+  return open[0] + close[0] + quote();
+}
@@ -0,0 +1,158 @@
+#!/bin/sh
+# This file is part of ProgramIndexer. It indexes function declarations,
+#    prototypes, and calls in C programs; and lists issues with functions
+#    including name collisions and shadow situations.
+#
+#    Copyright (C) 2013   Ezra Erb
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License version 3 as published
+#    by the Free Software Foundation.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#    I'd appreciate a note if you find this program useful or make
+#    updates. Please contact me through LinkedIn or github (my profile also has
+#    a link to the code depository)
+
+# Runs the .i files in this directory through the indexer in every mode and
+# compares the results with the expected ones.
+# Usage: run.sh [-u] indexer [scalar indexer]
+#   -u writes the expected results from the indexer instead of checking them
+#   The scalar indexer is a build with INDEX_SCALAR_SCAN defined. If given,
+#   its results must match the vector scan of the main one
+# MIN_SPEED sets the slowest allowed speed of the benchmark in MB/s (default 1)
+
+update=0
+if [ "$1" = "-u" ]; then
+  update=1
+  shift
+fi
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 [-u] indexer [scalar indexer]"
+  exit 2
+fi
+# The indexer is run from other directories, so its path must be absolute
+case "$1" in
+  /*) indexer="$1" ;;
+  *) indexer="$(pwd)/$1" ;;
+esac
+scalar=""
+if [ $# -ge 2 ]; then
+  case "$2" in
+    /*) scalar="$2" ;;
+    *) scalar="$(pwd)/$2" ;;
+  esac
+fi
+testDir="$(cd "$(dirname "$0")" && pwd)"
+inputs="knr.i markers.i pointers.i quotes.i statics.i wraps.i"
+work="$(mktemp -d "${TMPDIR:-/tmp}/indextestXXXXXX")" || exit 2
+trap 'rm -rf "$work"' EXIT
+failed=0
+
+# Writes the expected results, or checks the output against them
+check()
+{
+  name="$1"
+  expected="$testDir/expected/$2"
+  if [ $update -eq 1 ] && [ "$name" = "$2" ]; then
+    cp "$work/out" "$expected"
+    echo "wrote $2"
+  elif cmp -s "$expected" "$work/out"; then
+    echo "pass $name"
+  else
+    echo "FAIL $name"
+    diff "$expected" "$work/out" | head -20
+    failed=1
+  fi
+}
+
+# Runs the indexer in the test directory with the given options
+run()
+{
+  (cd "$testDir" && "$indexer" "$@" $inputs) > "$work/out" 2> /dev/null
+}
+
+if [ $update -eq 1 ]; then
+  mkdir -p "$testDir/expected"
+fi
+
+# Each record format, from the serial run
+run
+check table table
+run -t tsv
+check tsv tsv
+run -t csv
+check csv csv
+run -t json
+check json json
+# System headers left out
+run -x /usr/include
+check filtered filtered
+
+# Every other mode must match the serial results
+run -j 3
+check threads table
+run -p
+check pipelined table
+run -a 2
+check prefetch table
+run -m 4
+check spilled table
+# Too few file handles for every run, so sorting must fall back to memory.
+# With 12 a run can't be written; with 40 the runs can't all be merged
+for limit in 12 40; do
+  (ulimit -n $limit && cd "$testDir" &&
+   timeout 60 "$indexer" -m 1 $inputs) > "$work/out" 2> "$work/messages"
+  check spill-failed-$limit table
+  if ! grep -q "sorted in memory" "$work/messages"; then
+    echo "FAIL spill-failed-$limit message"
+    failed=1
+  fi
+done
+mkdir "$work/cache"
+run -c "$work/cache"
+check cache-write table
+run -c "$work/cache"
+check cache-read table
+
+# Pipes can't be mapped, so they are read with the stream fallback. Use the
+# same names so the warnings match
+mkdir "$work/fifo"
+writers=""
+for input in $inputs; do
+  mkfifo "$work/fifo/$input"
+  cat "$testDir/$input" > "$work/fifo/$input" &
+  writers="$writers $!"
+done
+(cd "$work/fifo" && "$indexer" $inputs) > "$work/out" 2> /dev/null
+# Writers for pipes the indexer never opened would wait forever
+kill $writers 2> /dev/null
+wait
+check fifo table
+
+if [ -n "$scalar" ]; then
+  (cd "$testDir" && "$scalar" $inputs) > "$work/out" 2> /dev/null
+  check scalar table
+  (cd "$testDir" && "$scalar" -p $inputs) > "$work/out" 2> /dev/null
+  check scalar-pipelined table
+fi
+
+# The benchmark checks its own modes against each other, and the speed
+if [ $update -eq 0 ]; then
+  if (cd "$work" && "$indexer" -b 1024,,"${MIN_SPEED:-1}") > "$work/out" 2>&1; then
+    echo "pass benchmark"
+  else
+    echo "FAIL benchmark"
+    tail -5 "$work/out"
+    failed=1
+  fi
+fi
+
+exit $failed
@@ -0,0 +1,23 @@
+# 1 "statics.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "statics.c"
+static int later(int a);
+static int never_defined(int a);
+static int twice(int a);
+static int twice(int a);
+
+int first(int a)
+{
+  return later(a) + twice(a);
+}
+
+static int later(int a)
+{
+  return a * 2;
+}
+
+static int twice(int a)
+{
+  return a;
+}
@@ -0,0 +1,29 @@
+# 1 "wraps.c"
+# 1 "<built-in>"
+# 1 "<command-line>"
+# 1 "wraps.c"
+int wrapped\
+_name(int a)
+{
+  return a + 1;
+}
+
+int split(int a,
+          int b)
+{
+  return wrapped_name(a) + \
+         wrapped_name(b);
+}
+
+char *text(void)
+{
+  return "one two \
+three";
+}
+
+int main(void)
+{
+  split(1, 2);
+  text();
+  return 0;
+}
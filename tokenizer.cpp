@@ -23,19 +23,26 @@
 // Tokenizer.cpp The object that tokenizes file input
 
 #include<string>
+#include<chrono>
 #include<fstream>
+#include<sstream>
 #include<iostream>
 #include<vector>
-#include<cctype>
-#include<list>
+#include<utility>
+#include<atomic>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
 #include"basetypes.h"
+#include"indexstats.h"
 #include"errors.h"
 #include"filebuffer.h"
+#include"spscqueue.h"
 #include"tokenizer.h"
+#include"pipeline.h"
 
 using std::string;
-using std::isalpha;
-using std::isdigit;
+using std::cout;
 
 /* This oject tokenizes the file input. It does so as follows:
    File input           Resulting token
@@ -53,13 +60,106 @@ using std::isdigit;
      any no of alpha or
      digits
      * [ ] or ,         declsymbol
+   region mark line     cachedregion, regionstart, or regionend
    anything else        othersymbol
 */
 
-const string Tokenizer::_digits = "1234567890";
-const string Tokenizer::_alpha = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
-const string Tokenizer::_declChars = "*[], \t";
-const string Tokenizer::_otherChars = "`!@#$%^+=|\\<>?/";
+/* Chars are classified by table lookup, both to pick how to lex a token from
+   its first char and to find where it ends. This avoids the C library
+   functions, which depend on the locale, and searching strings of chars */
+enum CharFlag {
+  alphaChar = 1, // Letters and underscore
+  digitChar = 2,
+  pointChar = 4, // Decimal point
+  declChar = 8, // Symbols allowed in declaration statements
+  otherChar = 16 // Symbols that tokenize to othersymbol
+};
+
+// How to lex a token, given its first char
+enum LeadKind { otherLead, identLead, numericLead, dotLead, quoteLead,
+                sinQuoteLead, minusLead, ampLead, semicolonLead, openBraceLead,
+                closeBraceLead, openParenLead, closeParenLead, regionLead };
+
+struct CharClass {
+  unsigned char lead; // LeadKind of a token starting with the char
+  unsigned char flags; // CharFlag values for the char
+};
+
+// Returns true if the char is in the text
+static constexpr bool inChars(const char* text, unsigned char testChar)
+{
+  return ((*text != '\0') &&
+          (((unsigned char)*text == testChar) || inChars(text + 1, testChar)));
+}
+
+static constexpr unsigned char charFlags(unsigned char testChar)
+{
+  return ((((testChar >= 'a') && (testChar <= 'z')) ||
+           ((testChar >= 'A') && (testChar <= 'Z')) || (testChar == '_')) ? alphaChar :
+          ((testChar >= '0') && (testChar <= '9')) ? digitChar :
+          (testChar == '.') ? pointChar :
+          inChars("*[], \t", testChar) ? declChar :
+          inChars("`!@#$%^+=|\\<>?/", testChar) ? otherChar : 0);
+}
+
+static constexpr unsigned char charLead(unsigned char testChar)
+{
+  return (((charFlags(testChar) & alphaChar) || (testChar == '~')) ? identLead :
+          (charFlags(testChar) & digitChar) ? numericLead :
+          (testChar == '.') ? dotLead :
+          (testChar == '"') ? quoteLead :
+          (testChar == '\'') ? sinQuoteLead :
+          (testChar == '-') ? minusLead :
+          (testChar == '&') ? ampLead :
+          (testChar == ';') ? semicolonLead :
+          (testChar == '{') ? openBraceLead :
+          (testChar == '}') ? closeBraceLead :
+          (testChar == '(') ? openParenLead :
+          (testChar == ')') ? closeParenLead :
+          ((testChar >= FileBuffer::cachedRegionMark) &&
+           (testChar <= FileBuffer::regionEndMark)) ? regionLead : otherLead);
+}
+
+#define CHAR_CLASS(testChar) { charLead(testChar), charFlags(testChar) }
+#define CHAR_CLASS_4(first) CHAR_CLASS(first), CHAR_CLASS(first + 1), \
+    CHAR_CLASS(first + 2), CHAR_CLASS(first + 3)
+#define CHAR_CLASS_16(first) CHAR_CLASS_4(first), CHAR_CLASS_4(first + 4), \
+    CHAR_CLASS_4(first + 8), CHAR_CLASS_4(first + 12)
+#define CHAR_CLASS_64(first) CHAR_CLASS_16(first), CHAR_CLASS_16(first + 16), \
+    CHAR_CLASS_16(first + 32), CHAR_CLASS_16(first + 48)
+
+static constexpr CharClass _charClasses[256] = {
+  CHAR_CLASS_64(0), CHAR_CLASS_64(64), CHAR_CLASS_64(128), CHAR_CLASS_64(192)
+};
+
+#undef CHAR_CLASS_64
+#undef CHAR_CLASS_16
+#undef CHAR_CLASS_4
+#undef CHAR_CLASS
+
+static_assert((_charClasses[(unsigned char)'z'].flags == alphaChar) &&
+              (_charClasses[(unsigned char)'9'].lead == numericLead) &&
+              (_charClasses[(unsigned char)'\t'].flags == declChar) &&
+              (_charClasses[(unsigned char)'/'].flags == otherChar) &&
+              (_charClasses[0xFF].lead == otherLead),
+              "Char class table is built wrong");
+
+// Returns true if the char has any of the given flags
+static inline bool charIs(char testChar, unsigned char flags)
+{
+  return ((_charClasses[(unsigned char)testChar].flags & flags) != 0);
+}
+
+/* Returns the first char at or after the position without any of the given
+   flags, or string::npos if there is none */
+static size_t skipChars(const string& text, size_t pos,
+                        unsigned char flags)
+{
+  size_t length = text.length();
+  while ((pos < length) && charIs(text[pos], flags))
+    pos++;
+  return (pos < length) ? pos : string::npos;
+}
 
 // Constructor
 Tokenizer::Tokenizer()
@@ -76,10 +176,12 @@ void Tokenizer::init()
     _charPtr = 0;
     _loadLineData = false;
     _newLinePos = 0;
+    _lineLoads = 0;
+    _wrapPos = string::npos;
 }
 
 // Returns true if the current char is an escaped newline
-bool Tokenizer::isLineWrap(unsigned int pos, bool multiLineQuote)
+bool Tokenizer::isLineWrap(size_t pos, bool multiLineQuote)
 {
   // If on the last line of input, by definition can't wrap
   if (_file.haveEOF())
@@ -88,45 +190,51 @@ bool Tokenizer::isLineWrap(unsigned int pos, bool multiLineQuote)
     return false; // Not in buffer!
   else if (_buffer[pos] != '\\')
     return false; // Not an escape character
+  else if (!multiLineQuote)
+    return (_wrapPos == pos);
   else
-    return (FileBuffer::getEscNewline(_buffer, multiLineQuote) == pos);
+    return (FileBuffer::getEscNewline(_buffer, true) == pos);
 }
 
 // Reloads the buffer from the file
 void Tokenizer::reloadBuffer(bool multiLineQuote)
 {
-  string tempBuffer;
-  unsigned int numKeepChars; // Num chars from old buffer to retain in new buffer
+  size_t firstIgnoreChar = 0; // End of the chars to retain in the buffer
 
-  if (_charPtr >= _buffer.length())
-    numKeepChars = 0; // Going to drop the entire buffer
-  else {
-    // Find chars to copy into new buffer
+  if (_charPtr < _buffer.length()) {
     // If the buffer has an escaped newline, don't include it
-    unsigned int firstIgnoreChar = FileBuffer::getEscNewline(_buffer, multiLineQuote);
+    firstIgnoreChar = multiLineQuote ? FileBuffer::getEscNewline(_buffer, true) : _wrapPos;
     if (firstIgnoreChar == string::npos) // None present
         firstIgnoreChar = _buffer.length();
-    if (firstIgnoreChar <= _charPtr)
-        numKeepChars = 0;
-    else
-        numKeepChars = firstIgnoreChar - _charPtr;
   }
 
-  if (numKeepChars > 0)
-    _buffer.assign(_buffer, _charPtr, numKeepChars);
-  else
-    _buffer.clear();
-  _newLinePos = numKeepChars; // New text starts after retained text
+  if (firstIgnoreChar <= _charPtr) {
+    _buffer.clear(); // Nothing to retain
+    _charPtr = 0;
+  }
+  else {
+    /* A token continues on the next line. Leave it where it is and splice
+       the next line on after it, so a token wrapped over many lines is not
+       copied again for each one. The chars before it are only dropped once
+       they outnumber the ones retained, which keeps the copying in
+       proportion to the text */
+    _buffer.resize(firstIgnoreChar);
+    if (_charPtr > (firstIgnoreChar - _charPtr)) {
+      _buffer.erase(0, _charPtr);
+      _charPtr = 0;
+    }
+  }
+  _newLinePos = _buffer.length(); // New text starts after retained text
   if (!_file.haveEOF()) {
-    _file>>tempBuffer;
-    _buffer += tempBuffer;
+    _file.appendLine(_buffer);
     _loadLineData = true;
   } // Not already at end of file
-  _charPtr = 0;
+  _wrapPos = FileBuffer::getEscNewline(_buffer, false);
+  _lineLoads++;
 }
 
 // Starts tokenizer on named file
-void Tokenizer::start(string fileName)
+void Tokenizer::start(const string& fileName)
 {
   init();
   _file.open(fileName);
@@ -134,6 +242,15 @@ void Tokenizer::start(string fileName)
   _location = _file.getFilePosition();
 }
 
+// Starts tokenizer on lines read from the named file by another thread
+void Tokenizer::start(const string& fileName, LineQueue& lines)
+{
+  init();
+  _file.open(fileName, lines);
+  reloadBuffer(false);
+  _location = _file.getFilePosition();
+}
+
 // Handles chars without special tokens
 Token Tokenizer::handleOtherChars()
 {
@@ -145,14 +262,14 @@ Token Tokenizer::handleOtherChars()
      declaration chars if the latter are found first */
   string lexeme;
   Token::TokenType wantType;
-  unsigned int end;
-  if (_declChars.find_first_of(_buffer[_charPtr]) != string::npos) {
+  size_t end;
+  if (charIs(_buffer[_charPtr], declChar)) {
     wantType = Token::declsymbol;
-    end = _buffer.find_first_not_of(_declChars, (_charPtr+1));
+    end = skipChars(_buffer, (_charPtr+1), declChar);
   }
   else {
     wantType = Token::othersymbol;
-    end = _buffer.find_first_not_of(_declChars + _otherChars, (_charPtr+1));
+    end = skipChars(_buffer, (_charPtr+1), (declChar | otherChar));
   }
   if (end == string::npos)
     end = _buffer.length() - 1;
@@ -166,7 +283,7 @@ Token Tokenizer::handleOtherChars()
 // Processes a numeric literal
 Token Tokenizer::getNumeric()
 {
-  unsigned int end = _charPtr;
+  size_t end = _charPtr;
   bool haveLexeme = false;
   bool seenE = false;
   string lexeme;
@@ -175,7 +292,7 @@ Token Tokenizer::getNumeric()
     if (end > (_buffer.length() - 1))
       end = string::npos;
     else
-      end = _buffer.find_first_not_of((_digits+'.'), end);
+      end = skipChars(_buffer, end, (digitChar | pointChar));
     if (end == string::npos) {
       end = _buffer.length();
       haveLexeme = true;
@@ -209,7 +326,7 @@ Token Tokenizer::getNumeric()
 Token Tokenizer::getQuotedString()
 {
   bool haveValue = false;
-  unsigned int end = _charPtr + 1;
+  size_t end = _charPtr + 1;
   string lexeme;
 
   while (!haveValue) {
@@ -233,10 +350,9 @@ Token Tokenizer::getQuotedString()
 // Processes an identifier
 Token Tokenizer::getIdentifier()
 {
-  unsigned int end;
+  size_t end;
   bool haveLexeme = false;
   string lexeme;
-  string temp;
 
   // The first char has different rules from the rest
   lexeme = _buffer[_charPtr];
@@ -247,7 +363,7 @@ Token Tokenizer::getIdentifier()
     if (end > (_buffer.length() - 1))
       end = string::npos;
     else
-      end = _buffer.find_first_not_of((_alpha + _digits), end);
+      end = skipChars(_buffer, end, (alphaChar | digitChar));
     if (end == string::npos)
       haveLexeme = true;
     // If line is wrapped, then load the rest
@@ -263,10 +379,8 @@ Token Tokenizer::getIdentifier()
     end = _buffer.length();
   else
     end--; // Ends one beyond what is wanted
-  if (end >= _charPtr) {
-    temp.assign(_buffer, _charPtr, (end - _charPtr + 1));
-    lexeme+=temp;
-  }
+  if (end >= _charPtr)
+    lexeme.append(_buffer, _charPtr, (end - _charPtr + 1));
   _charPtr = end;
   return Token(lexeme, _location, Token::identifier);
 }
@@ -365,7 +479,7 @@ Token Tokenizer::handleSinQuote()
            or the NUL escape sequence. Need next char to tell which */
         else if (testChar == '0')
             haveZero = true;
-        else if (isdigit(testChar))
+        else if (charIs(testChar, digitChar))
             haveOct = true;
         else if (testChar == 'x')
             haveHex = true;
@@ -380,13 +494,13 @@ Token Tokenizer::handleSinQuote()
 
       case 4:
         // Check if a zero is part of oct number, or NUL escape sequence
-        if (haveZero && isdigit(testChar))
+        if (haveZero && charIs(testChar, digitChar))
             haveOct = true; // Zero is first digit of octal number
 
         if (haveOct)
-            haveError = (!isdigit(testChar));
+            haveError = (!charIs(testChar, digitChar));
         else if (haveHex)
-            haveError = ((!isdigit(testChar)) && (testChar != 'A') &&
+            haveError = ((!charIs(testChar, digitChar)) && (testChar != 'A') &&
                          (testChar != 'B') &&(testChar != 'C') &&
                          (testChar != 'D') &&(testChar != 'E') &&
                          (testChar != 'F'));
@@ -398,9 +512,9 @@ Token Tokenizer::handleSinQuote()
 
       case 5:
         if (haveOct)
-            haveError = (!isdigit(testChar));
+            haveError = (!charIs(testChar, digitChar));
         else if (haveHex)
-            haveError = ((!isdigit(testChar)) && (testChar != 'A') &&
+            haveError = ((!charIs(testChar, digitChar)) && (testChar != 'A') &&
                          (testChar != 'B') &&(testChar != 'C') &&
                          (testChar != 'D') &&(testChar != 'E') &&
                          (testChar != 'F'));
@@ -429,142 +543,282 @@ Token Tokenizer::handleSinQuote()
     return handleOtherChars();
 }
 
+// Processes a line written by the file buffer for an excluded region
+Token Tokenizer::getRegionMark()
+{
+  Token::TokenType wantType;
+  if (_buffer[_charPtr] == FileBuffer::cachedRegionMark)
+    wantType = Token::cachedregion;
+  else if (_buffer[_charPtr] == FileBuffer::regionStartMark)
+    wantType = Token::regionstart;
+  else
+    wantType = Token::regionend;
+  // The rest of the line is the key of the region
+  string lexeme(_buffer, _charPtr + 1, string::npos);
+  _charPtr = _buffer.length() - 1;
+  return Token(lexeme, _location, wantType);
+}
+
 // Lexes the next token in the file
 Token Tokenizer::nextToken()
 {
-  Token returnToken;
-  bool haveChar;
+  STATS_TIMER(tokenStage);
 
   if (haveEOF()) {
     FilePosition temp(_location); // Should be pointing to last line of file
     temp.incrLine();
     return Token("", temp, Token::tokenEOF);
   }
-  else {
-    if (isalpha(_buffer[_charPtr]) || (_buffer[_charPtr] == '_') ||
-	(_buffer[_charPtr] == '~'))
-      returnToken = getIdentifier();
-    else if (isdigit(_buffer[_charPtr]))
-      returnToken = getNumeric();
-    else
-      switch(_buffer[_charPtr]) {
-      case '"':
-        returnToken = getQuotedString();
-        break;
+  else
+    return lexToken();
+}
 
-      case '-':
-        returnToken = handleMinus();
-        break;
+/* Lexes the rest of the current line into the end of the list, stopping
+   early at the given count. Returns the number added */
+unsigned int Tokenizer::nextTokens(vector<Token>& tokens, unsigned int maxTokens)
+{
+  STATS_TIMER(tokenStage);
 
-      case '\'':
-        returnToken = handleSinQuote();
-        break;
+  if (haveEOF()) {
+    FilePosition temp(_location); // Should be pointing to last line of file
+    temp.incrLine();
+    tokens.push_back(Token("", temp, Token::tokenEOF));
+    return 1;
+  }
+  /* Lexing the last token on a line reads the next one, so stop after any
+     token that reloads the buffer. This also keeps warnings from the file
+     in the same order relative to the ones found while parsing */
+  unsigned int startLoads = _lineLoads;
+  unsigned int count = 0;
+  do {
+    tokens.push_back(lexToken());
+    count++;
+  } while ((count < maxTokens) && (_lineLoads == startLoads) && (!haveEOF()));
+  return count;
+}
 
-      case '&':
-        returnToken = handleAmpersand();
-        break;
+// Lexes the token at the current position and moves to the next one
+Token Tokenizer::lexToken()
+{
+  Token returnToken;
+  bool haveChar;
 
-      case '.':
-        // Check for leading decimal point of a numeric
-        if ((_charPtr == (_buffer.length() - 1)) ||
-            (!isdigit(_buffer[_charPtr + 1])))
-            returnToken = Token(_buffer[_charPtr], _location, Token::fieldaccess);
-        else
-            returnToken = getNumeric();
-        break;
+  STATS_COUNT(tokens, 1);
+  switch(_charClasses[(unsigned char)_buffer[_charPtr]].lead) {
+  case identLead:
+    returnToken = getIdentifier();
+    break;
+
+  case numericLead:
+    returnToken = getNumeric();
+    break;
+
+  case quoteLead:
+    returnToken = getQuotedString();
+    break;
+
+  case minusLead:
+    returnToken = handleMinus();
+    break;
+
+  case sinQuoteLead:
+    returnToken = handleSinQuote();
+    break;
+
+  case ampLead:
+    returnToken = handleAmpersand();
+    break;
+
+  case dotLead:
+    // Check for leading decimal point of a numeric
+    if ((_charPtr == (_buffer.length() - 1)) ||
+        (!charIs(_buffer[_charPtr + 1], digitChar)))
+        returnToken = Token(_buffer[_charPtr], _location, Token::fieldaccess);
+    else
+        returnToken = getNumeric();
+    break;
 
-      case ';':
-        returnToken = Token(_buffer[_charPtr], _location, Token::semicolon);
-        break;
+  case semicolonLead:
+    returnToken = Token(_buffer[_charPtr], _location, Token::semicolon);
+    break;
 
-      case '{':
-        returnToken = Token(_buffer[_charPtr], _location, Token::openbrace);
-        break;
+  case openBraceLead:
+    returnToken = Token(_buffer[_charPtr], _location, Token::openbrace);
+    break;
 
-      case '}':
-        returnToken = Token(_buffer[_charPtr], _location, Token::closebrace);
-        break;
+  case closeBraceLead:
+    returnToken = Token(_buffer[_charPtr], _location, Token::closebrace);
+    break;
 
-      case '(':
-        returnToken = Token(_buffer[_charPtr], _location, Token::openparen);
-        break;
+  case openParenLead:
+    returnToken = Token(_buffer[_charPtr], _location, Token::openparen);
+    break;
 
-      case ')':
-        returnToken = Token(_buffer[_charPtr], _location, Token::closeparen);
-        break;
+  case closeParenLead:
+    returnToken = Token(_buffer[_charPtr], _location, Token::closeparen);
+    break;
 
-      default:
-        returnToken = handleOtherChars();
-      }
-    // Find the next char to process
-    _charPtr++; // move off previous char
-    haveChar = false;
-    while ((!haveChar) &&
-           ((!_file.haveEOF()) || (_charPtr < _buffer.length()))) {
-      // Burn spaces and tabs
-      if (_charPtr < _buffer.length())
-        _charPtr = FileBuffer::burnSpaces(_buffer, _charPtr);
-
-      if (_charPtr == string::npos)
-        _charPtr = _buffer.length();
-      // If now on an escaped newline, burn it
-      else if (isLineWrap(_charPtr, false))
-        _charPtr = _buffer.length();
-
-      // If beyond end of _buffer, reload; else have wanted char
-      if (_charPtr >= _buffer.length())
-        reloadBuffer(false);
-      else
-        haveChar = true;
-    }
-    // Update position information if needed
-    if (_loadLineData && (_charPtr >= _newLinePos)) {
-      _location = _file.getFilePosition();
-      _loadLineData = false;
-    }
-    return returnToken;
+  case regionLead:
+    returnToken = getRegionMark();
+    break;
+
+  default:
+    returnToken = handleOtherChars();
+  }
+  // Find the next char to process
+  _charPtr++; // move off previous char
+  haveChar = false;
+  while ((!haveChar) &&
+         ((!_file.haveEOF()) || (_charPtr < _buffer.length()))) {
+    // Burn spaces and tabs
+    if (_charPtr < _buffer.length())
+      _charPtr = FileBuffer::burnSpaces(_buffer, _charPtr);
+
+    if (_charPtr == string::npos)
+      _charPtr = _buffer.length();
+    // If now on an escaped newline, burn it
+    else if (isLineWrap(_charPtr, false))
+      _charPtr = _buffer.length();
+
+    // If beyond end of _buffer, reload; else have wanted char
+    if (_charPtr >= _buffer.length())
+      reloadBuffer(false);
+    else
+      haveChar = true;
+  }
+  // Update position information if needed
+  if (_loadLineData && (_charPtr >= _newLinePos)) {
+    _location = _file.getFilePosition();
+    _loadLineData = false;
   }
+  return returnToken;
 }
 
 // Constructor
 TokenList::TokenList()
+    : _pipeline(NULL), _log(&cout), _markerFlags(false), _headerCache(NULL),
+      _copyFiles(false)
 {
+    _batch.tokens.reserve(_MaxBatchTokens);
+    _file.setLog(_fileLog);
     initVars();
 }
 
-Token TokenList::nextToken()
+// Destructor
+TokenList::~TokenList()
+{
+    delete _pipeline;
+}
+
+// Opens the list on the given file
+void TokenList::start(const string& fileName)
 {
-  Token temp;
-  if (_holdList.empty())
-    temp = _file.nextToken();
+  initVars();
+  if (_pipeline == NULL) {
+    _file.start(fileName);
+    // Opening reads the first line, so may issue warnings
+    if (_fileLog.tellp() > 0) {
+      *_log << _fileLog.str();
+      _fileLog.str("");
+    }
+  }
   else {
-    temp = _holdList.front();
-    _holdList.pop_front();
+    _pipeline->setMarkerFlags(_markerFlags);
+    _pipeline->setHeaderCache(_headerCache);
+    _pipeline->setCopyFiles(_copyFiles);
+    _pipeline->start(fileName);
+    // The first batch has no tokens, only the warnings from opening the file
+    if (_pipeline->nextBatch(_batch))
+      *_log << _batch.log;
+    _batch.clear();
   }
-  resetLookahead(); // Just read a token, so old lookahead is invalid
-  return temp;
 }
 
-Token TokenList::nextLookahead()
+// Sets whether files are read and lexed on separate threads
+void TokenList::setPipelined(bool pipelined)
 {
-  list<Token>::const_iterator temp;
+  if (pipelined && (_pipeline == NULL))
+    _pipeline = new FilePipeline();
+  else if ((!pipelined) && (_pipeline != NULL)) {
+    delete _pipeline;
+    _pipeline = NULL;
+  }
+}
 
-  if (_lookPtr == _holdList.end()) { // First lookahead after a Get
-    if (_holdList.empty())
-      _holdList.push_back(_file.nextToken());
-    _lookPtr = _holdList.begin();
+// Lexes another batch onto the end of the array
+void TokenList::fillTokens()
+{
+  /* Every token lexed so far has been handed out, so all their warnings were
+     written. Drop consumed tokens, so the array does not grow with the file */
+  if (_tokenPos > 0) {
+    _batch.tokens.erase(_batch.tokens.begin(), _batch.tokens.begin() + _tokenPos);
+    _tokenPos = 0;
   }
+  _batch.log.clear();
+  _batch.marks.clear();
+  _nextMark = 0;
+  if (_pipeline != NULL)
+    takeBatch();
   else {
-    temp = _lookPtr;
-    _lookPtr++;
-    if (_lookPtr == _holdList.end()) {
-      // Next element is not in the list
-      _holdList.push_back(_file.nextToken());
-      // Restore and reiterate, so iterator points to new element
-      _lookPtr = temp;
-      _lookPtr++;
+    _file.nextTokens(_batch.tokens, _MaxBatchTokens);
+    if (_fileLog.tellp() > 0)
+      _batch.addLog(_fileLog);
+  }
+}
+
+// Takes the next batch from the pipeline onto the end of the array
+void TokenList::takeBatch()
+{
+  if (_haveLastBatch) {
+    _batch.tokens.push_back(_eofToken);
+    return;
+  }
+  // Swap the batch in when possible, handing the old storage back to reuse
+  bool haveTokens = (!_batch.tokens.empty());
+  TokenBatch& next = haveTokens ? _spare : _batch;
+  if (!_pipeline->nextBatch(next)) {
+    // Stopped early, so end the file here
+    next.clear();
+    next.tokens.push_back(Token("", FilePosition("", 0), Token::tokenEOF));
+    next.last = true;
+  }
+  if (next.last) {
+    _haveLastBatch = true;
+    _eofToken = next.tokens.back();
+    _pipeline->stop();
+  }
+  if (haveTokens) {
+    unsigned int offset = _batch.tokens.size();
+    unsigned int index;
+    for (index = 0; index < _spare.tokens.size(); index++)
+      _batch.tokens.push_back(std::move(_spare.tokens[index]));
+    _batch.log.swap(_spare.log);
+    for (index = 0; index < _spare.marks.size(); index++) {
+      TokenBatch::LogMark mark = _spare.marks[index];
+      mark.token += offset;
+      _batch.marks.push_back(mark);
     }
   }
-  return (*_lookPtr);
+}
+
+Token TokenList::nextToken()
+{
+  resetLookahead(); // Just read a token, so old lookahead is invalid
+  if (holdCount() == 0)
+    fillTokens();
+  releaseLog(_tokenPos);
+  Token temp(std::move(holdToken(0)));
+  _tokenPos++;
+  return temp;
+}
+
+const Token& TokenList::nextLookahead()
+{
+  // If the next token has not been lexed yet, lex the next line
+  if (_lookCount == holdCount())
+    fillTokens();
+  releaseLog(_tokenPos + _lookCount);
+  _lookCount++;
+  return holdToken(_lookCount - 1);
 }
 
@@ -20,26 +20,23 @@
     updates. Please contact me through LinkedIn or github (my profile also has
     a link to the code depository)
 */
-using std::list;
 using std::pair;
+using std::ostringstream;
 
 class Tokenizer {
 private:
-  static const string _digits;
-  static const string _alpha;
-  static const string _declChars; // Symbols allowed in declaration statements
-  static const string _otherChars; // Chars that tokenize to othersymbol
-
   FileBuffer _file;
   string _buffer; // Actual line from the file being processed
-  unsigned int _charPtr; // Location of data to tokenize
+  size_t _charPtr; // Location of data to tokenize
   /* The text for a token may wrap between lines, requiring a file read before the
      token finishes. The location should reflect where it starts in this case. Turns out
      the cheapest way of tracking this is to cache the location in this object, and only
      update it between processing each token */
   FilePosition _location; // Location in file of data for current token
   bool _loadLineData; // True need to reload line data after processing token
-  unsigned int _newLinePos; // Location in buffer of start of next file line
+  size_t _newLinePos; // Location in buffer of start of next file line
+  unsigned int _lineLoads; // Number of times the buffer was reloaded
+  size_t _wrapPos; // Escaped newline ending the buffer, string::npos if none
 
   // Initializes state
   void init();
@@ -48,7 +45,7 @@ private:
   void reloadBuffer(bool multiLineQuote);
 
   // Returns true if the indexed char indicates a wrapped line
-  bool isLineWrap(unsigned int pos, bool multiLineQuote);
+  bool isLineWrap(size_t pos, bool multiLineQuote);
 
   // Handles chars without special tokens
   Token handleOtherChars();
@@ -71,6 +68,12 @@ private:
   // Processes a single quote
   Token handleSinQuote();
 
+  // Processes a line written by the file buffer for an excluded region
+  Token getRegionMark();
+
+  // Lexes the token at the current position and moves to the next one
+  Token lexToken();
+
   // The tokenizer is based on a file, so it can't be copied
   Tokenizer(const Tokenizer& other);
   Tokenizer & operator=(const Tokenizer& other);
@@ -82,30 +85,159 @@ public:
   // This object uses the default destructor
 
   // Starts tokenizer on named file
-  void start(string fileName);
+  void start(const string& fileName);
+
+  // Starts tokenizer on lines read from the named file by another thread
+  void start(const string& fileName, LineQueue& lines);
+
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
+  // Sets whether line markers may be followed by flags
+  void setMarkerFlags(bool markerFlags);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(const HeaderCache* headerCache);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
 
   // Lexes and returns next token
   Token nextToken();
 
+  /* Lexes the rest of the current line into the end of the list, stopping
+     early at the given count. Returns the number added */
+  unsigned int nextTokens(vector<Token>& tokens, unsigned int maxTokens);
+
   // Returns true if entire file has been processed
   bool haveEOF();
 };
 
+// Sets where warning messages are written
+inline void Tokenizer::setLog(ostream& log)
+{
+  _file.setLog(log);
+}
+
+// Sets whether line markers may be followed by flags
+inline void Tokenizer::setMarkerFlags(bool markerFlags)
+{
+  _file.setMarkerFlags(markerFlags);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void Tokenizer::setHeaderCache(const HeaderCache* headerCache)
+{
+  _file.setHeaderCache(headerCache);
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void Tokenizer::setCopyFiles(bool copyFiles)
+{
+  _file.setCopyFiles(copyFiles);
+}
+
 // Returns true if entire file has been processed
 inline bool Tokenizer::haveEOF()
 {
   return (_file.haveEOF() && (_charPtr >= _buffer.length()));
 }
 
-// The tokenizer needs to support lookahead. This is implented as a list
+/* Tokens lexed by one object, to be handed out by another, possibly on a
+   different thread. Warnings from the file are issued when the text of a line
+   runs out, so they are kept with the token being lexed at the time. They can
+   then be written when that token is handed out, where they would appear if
+   tokens were lexed one at a time */
+struct TokenBatch
+{
+  struct LogMark
+  {
+    unsigned int token; // Index of the token being lexed
+    size_t logEnd; // End of its warnings within the batch
+  };
+
+  vector<Token> tokens;
+  string log; // Warnings, end to end
+  vector<LogMark> marks;
+  bool last; // True, no batches follow this one
+
+  TokenBatch();
+
+  void clear();
+
+  // Moves the warnings in the stream to the batch, for the last token
+  void addLog(ostringstream& fileLog);
+};
+
+inline TokenBatch::TokenBatch()
+    : last(false)
+{
+}
+
+inline void TokenBatch::clear()
+{
+  tokens.clear();
+  log.clear();
+  marks.clear();
+  last = false;
+}
+
+// Moves the warnings in the stream to the batch, for the last token
+inline void TokenBatch::addLog(ostringstream& fileLog)
+{
+  log += fileLog.str();
+  fileLog.str("");
+  LogMark mark = { static_cast<unsigned int>(tokens.size() - 1), log.length() };
+  marks.push_back(mark);
+}
+
+typedef SpscQueue<TokenBatch> TokenQueue;
+
+class FilePipeline; // Lexes a file on other threads, see pipeline.h
+
+/* The tokenizer needs to support lookahead. Tokens are lexed a line at a
+   time into a contiguous array, which the parser then consumes. Lookahead past
+   the end of the array lexes the next line onto it. This keeps the tokenizer
+   in a tight loop and avoids allocating memory for each token.
+     When pipelined, the file is read and lexed on other threads, and this
+   object takes the tokens in batches from them instead */
 class TokenList {
 private:
+  static const unsigned int _MaxBatchTokens = 256; // Limit on one lexing pass
+
   Tokenizer _file; // Source of tokens
-  list<Token> _holdList; // List of tokenized tokens
-  list<Token>::const_iterator _lookPtr; // Last accessed lookahead element
+  FilePipeline* _pipeline; // Source of tokens when pipelined, otherwise NULL
+  TokenBatch _batch; // Tokens lexed but not yet consumed, with their warnings
+  TokenBatch _spare; // Next batch from the pipeline, when some remain in the above
+  bool _haveLastBatch; // True, the pipeline has returned every token
+  Token _eofToken; // Returned once the pipeline runs out
+  unsigned int _tokenPos; // Location of next token to return
+  unsigned int _lookCount; // Number of lookahead tokens read since the last get
+  unsigned int _nextMark; // First warning in the batch not yet written
+  Token _noToken; // Returned when there is no lookahead token
+  ostream* _log; // Destination of warning messages
+  ostringstream _fileLog; // Warnings from the tokenizer, moved into the batch
+  bool _markerFlags; // True, line markers may be followed by flags
+  const HeaderCache* _headerCache; // NULL if excluded regions are not cached
+  bool _copyFiles; // True, files are copied into memory instead of mapped
 
   void initVars();
 
+  // Returns the indexed unconsumed token, counting from the first one
+  Token& holdToken(unsigned int index);
+
+  // Returns the number of tokens lexed but not consumed
+  unsigned int holdCount() const;
+
+  // Lexes another batch onto the end of the array
+  void fillTokens();
+
+  // Takes the next batch from the pipeline onto the end of the array
+  void takeBatch();
+
+  // Writes any held warnings once the indexed token is handed out
+  void releaseLog(unsigned int tokenPos);
+
   // This object is based on a tokenizer, so it can't be copied
   TokenList(const TokenList& other);
   const TokenList& operator=(const TokenList& other);
@@ -114,17 +246,35 @@ public:
   // Constructor
   TokenList();
 
+  // Destructor
+  ~TokenList();
+
   // Opens the list on the given file
-  void start(string fileName);
+  void start(const string& fileName);
+
+  // Sets where warning messages are written
+  void setLog(ostream& log);
+
+  // Sets whether files are read and lexed on separate threads
+  void setPipelined(bool pipelined);
+
+  // Sets whether line markers may be followed by flags
+  void setMarkerFlags(bool markerFlags);
+
+  // Sets the cache of excluded regions, or NULL to read them all
+  void setHeaderCache(const HeaderCache* headerCache);
+
+  // Sets whether files are copied into memory instead of mapped
+  void setCopyFiles(bool copyFiles);
 
   // Returns the next token to process
   Token nextToken();
 
   // Looks ahead one token in the token stream
-  Token nextLookahead();
+  const Token& nextLookahead();
 
   // Returns the most recently found lookahead token
-  Token lastLookahead();
+  const Token& lastLookahead();
 
   // Resets the lookahead pointer, so a token can be reprocessed
   void resetLookahead();
@@ -135,42 +285,93 @@ public:
 
 inline void TokenList::initVars()
 {
-    _holdList.clear();
-    _lookPtr = _holdList.end();
+    _batch.clear();
+    _haveLastBatch = false;
+    _tokenPos = 0;
+    _lookCount = 0;
+    _nextMark = 0;
 }
 
-// Opens the list on the given file
-inline void TokenList::start(string fileName)
+// Returns the indexed unconsumed token, counting from the first one
+inline Token& TokenList::holdToken(unsigned int index)
 {
-    initVars();
-    _file.start(fileName);
+    return _batch.tokens[_tokenPos + index];
+}
+
+// Returns the number of tokens lexed but not consumed
+inline unsigned int TokenList::holdCount() const
+{
+    return _batch.tokens.size() - _tokenPos;
+}
+
+// Sets where warning messages are written
+inline void TokenList::setLog(ostream& log)
+{
+    _log = &log;
+}
+
+// Sets whether line markers may be followed by flags
+inline void TokenList::setMarkerFlags(bool markerFlags)
+{
+    _markerFlags = markerFlags;
+    _file.setMarkerFlags(markerFlags);
+}
+
+// Sets the cache of excluded regions, or NULL to read them all
+inline void TokenList::setHeaderCache(const HeaderCache* headerCache)
+{
+    _headerCache = headerCache;
+    _file.setHeaderCache(headerCache);
+}
+
+// Sets whether files are copied into memory instead of mapped
+inline void TokenList::setCopyFiles(bool copyFiles)
+{
+    _copyFiles = copyFiles;
+    _file.setCopyFiles(copyFiles);
+}
+
+// Writes any held warnings once the indexed token is handed out
+inline void TokenList::releaseLog(unsigned int tokenPos)
+{
+    while ((_nextMark < _batch.marks.size()) &&
+           (_batch.marks[_nextMark].token <= tokenPos)) {
+        size_t logStart = (_nextMark == 0) ? 0 : _batch.marks[_nextMark - 1].logEnd;
+        _log->write(_batch.log.data() + logStart,
+                    _batch.marks[_nextMark].logEnd - logStart);
+        _nextMark++;
+    }
 }
 
 // Resets the lookahead pointer, so a token can be reprocessed
 inline void TokenList::resetLookahead()
 {
-    _lookPtr = _holdList.end();
+    _lookCount = 0;
 }
 
 // Returns the most recently found lookahead token
-inline Token TokenList::lastLookahead()
+inline const Token& TokenList::lastLookahead()
 {
-  if (_lookPtr == _holdList.end()) { // First lookahead after a get
-    Token temp;
-    return temp;
-  }
+  if (_lookCount == 0) // First lookahead after a get
+    return _noToken;
   else
-    return (*_lookPtr);
+    return holdToken(_lookCount - 1);
 }
 
 // Returns true when all tokens from the source file have been found
 inline bool TokenList::haveEOF()
 {
+    /* The pipeline only reports the end of file with a token, so have to look
+       for it if nothing is waiting */
+    if (_pipeline != NULL) {
+        if (holdCount() == 0)
+            fillTokens();
+        return (holdToken(0).getType() == Token::tokenEOF);
+    }
     /* Have reached the end when the source file is fully
         processed, and either the hold list is empty or the
         next token indicates end of file */
     return (_file.haveEOF() &&
-            (_holdList.empty() ||
-             (_holdList.front().getType() == Token::tokenEOF)));
+            ((holdCount() == 0) ||
+             (holdToken(0).getType() == Token::tokenEOF)));
 }
-